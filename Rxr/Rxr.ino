@@ -15,8 +15,10 @@
 #include <MirfSpiDriver.h>
 #include <nRF24L01.h>
 #include <EEPROM.h>
+#include <avr/sleep.h>
 #include "NewTimerOne.h"
 #include "settings.h"
+#include "power.h"
 #include "console.h"
 #include "util.h"
 #include "constants.h"
@@ -26,11 +28,35 @@
 #include "serial_api.h"
 #include "radio.h"
 
+// once the controller has put the motor to sleep the control
+// ISR would only return early 6000 times a second, so Timer1 is stopped
+// until a move wakes the controller again, and loop() idles the CPU between
+// passes. Timer0 (millis) wakes it within a millisecond to poll the radio,
+// USB wakes it for serial. Moves only come from radio_run() and
+// console_run() in this same loop, so the timer is always running again
+// before the first step is due.
+bool isr_parked = false;
+
 void timer_interrupt()
 {
     controller_run();
 }
 
+void park_control_isr()
+{
+    if (controller_is_asleep()) {
+        if (!isr_parked) {
+            Timer1.stop();
+            isr_parked = true;
+        }
+        set_sleep_mode(SLEEP_MODE_IDLE);
+        sleep_mode();
+    } else if (isr_parked) {
+        Timer1.restart();
+        isr_parked = false;
+    }
+}
+
 void setup()
 {
     Serial.begin(SERIAL_BAUD);
@@ -47,10 +73,18 @@ void setup()
     ANT_CTRL1(CLR);
     ANT_CTRL2(SET);
 
+    settings_init();
     controller_init();
+    long motor_position, target_position;
+    if (settings_take_position(&motor_position, &target_position)) {
+        controller_initialize_position(motor_position);
+        controller_move_to_position(target_position);
+    }
     radio_init();
-    controller_set_accel(1);
-    controller_set_speed(1);
+    controller_set_accel(settings_get_accel());
+    controller_set_speed(settings_get_max_speed());
+    controller_set_mode(settings_get_mode());
+    power_init();
 
     Timer1.initialize();
     Timer1.attachInterrupt(timer_interrupt, ISR_PERIOD);
@@ -60,4 +94,7 @@ void loop()
 {
     radio_run();
     console_run();
+    settings_run();
+    power_run();
+    park_control_isr();
 }
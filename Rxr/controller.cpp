@@ -1,3 +1,6 @@
+#include <stdint.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
 #include "controller.h"
 #include "constants.h"
 #include "util.h"
@@ -18,6 +21,38 @@ void _controller_wake_up()
     motor_wake();
 }
 
+void _controller_set_limits(long speed, long accel)
+{
+    state.max_speed = speed;
+    state.accel = accel;
+    state.decel_denominator = fixed_mult(accel, i32_to_fixed(2L));
+}
+
+void _controller_end_timed_move()
+{
+    state.timed = false;
+    _controller_set_limits(state.profile_speed, state.profile_accel);
+}
+
+unsigned long _controller_sqrt(unsigned long x)
+{
+    unsigned long root = 0;
+    unsigned long bit = 1UL << 30;
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
 void controller_init()
 {
     state.direction = 1;
@@ -25,6 +60,9 @@ void controller_init()
     state.accel = 0;
     state.mode = 0;
     state.decel_denominator = 0;
+    state.profile_speed = 0;
+    state.profile_accel = 0;
+    state.timed = false;
     state.velocity = 0;
     state.calculated_position = 0;
     state.motor_position = 0;
@@ -32,6 +70,7 @@ void controller_init()
     state.run_count = 0;
     state.sleeping = true;
     state.initial_position_set = false;
+    state.held = false;
     _controller_sleep();
     motor_set_steps(EIGHTH_STEPS);
 }
@@ -46,6 +85,11 @@ bool controller_is_position_initialized()
     return state.initial_position_set;
 }
 
+bool controller_is_asleep()
+{
+    return state.sleeping;
+}
+
 void controller_initialize_position(long position)
 {
     state.motor_position = position;
@@ -57,41 +101,119 @@ void controller_initialize_position(long position)
 void controller_move_to_position(long position)
 {
     if (position != state.target_position) {
+        if (state.timed) {
+            _controller_end_timed_move();
+        }
         _controller_wake_up();
         state.run_count = 0;
     }
     state.target_position = position;
 }
 
+// worked out in ms rather than ISR periods so that nothing
+// overflows 32 bits. With the accel a in fixed steps per period^2 and the
+// distance d in fixed steps, a rest to rest trapezoid that takes t ms
+// cruises at
+//   v = 2d / (t + sqrt(t^2 - d / 9a))  fixed steps per ms
+// which is d / 3(t + sqrt(t^2 - d / 9a)) per period, at 6 periods to the ms.
+// When t^2 < d / 9a not even a triangle at accel a makes it, so a is raised
+// to d / 9t^2, rounded up, and the same formula trims the cruise to suit.
+// controller_run() then flies it as it would any other move, accelerating
+// to max_speed and braking on the decel threshold.
+void controller_move_to_position_in(long position, unsigned int duration_ms)
+{
+    controller_move_to_position(position);
+
+    uint8_t sreg = SREG;
+    cli();
+    unsigned long distance = abs32(position - state.calculated_position);
+    SREG = sreg;
+    if (!duration_ms || !distance) {
+        return;
+    }
+
+    // a minute at most, so t^2 below stays in 32 bits
+    unsigned long t = min32(duration_ms, 60000L);
+    unsigned long t_squared = t * t;
+    long accel = max32(state.profile_accel, 1L);
+    if (t_squared < distance / (9UL * accel)) {
+        // rounded up, and the cruise below trimmed to suit
+        accel = (distance + 9 * t_squared - 1) / (9 * t_squared);
+    }
+    // the motor takes its last step as the brake comes within a step of
+    // the end, sqrt(2 / a) periods early; the plan runs that much longer
+    t += _controller_sqrt(2 * FIXED_ONE / accel) / 6;
+    t_squared = t * t;
+    long speed = distance /
+        (3 * (t + _controller_sqrt(t_squared - distance / (9UL * accel))));
+
+    sreg = SREG;
+    cli();
+    state.timed = true;
+    _controller_set_limits(clamp32(speed, 1L, FIXED_ONE),
+        clamp32(accel, 1L, 256L));
+    SREG = sreg;
+}
+
 long controller_get_target_position()
 {
     return state.target_position;
 }
 
+long controller_get_motor_position()
+{
+    // four bytes the ISR writes
+    uint8_t sreg = SREG;
+    cli();
+    long position = state.motor_position;
+    SREG = sreg;
+    return position;
+}
+
+void controller_hold(bool hold)
+{
+    state.held = hold;
+    if (hold) {
+        // restart from rest rather than at the speed it stopped at
+        state.velocity = 0;
+        state.calculated_position = state.motor_position;
+    }
+}
+
 void controller_set_mode(int mode)
 {
     state.mode = mode;
 }
 
+int controller_get_mode()
+{
+    return state.mode;
+}
+
 void controller_set_speed(long speed)
 {
-    state.max_speed = clamp32(speed, 1L, FIXED_ONE);
+    state.profile_speed = clamp32(speed, 1L, FIXED_ONE);
+    if (!state.timed) {
+        _controller_set_limits(state.profile_speed, state.accel);
+    }
 }
 
 void controller_set_accel(long accel)
 {
-    state.accel = clamp32(accel, 1L, 256L);
-    state.decel_denominator = fixed_mult(state.accel, i32_to_fixed(2L));
+    state.profile_accel = clamp32(accel, 1L, 256L);
+    if (!state.timed) {
+        _controller_set_limits(state.max_speed, state.profile_accel);
+    }
 }
 
 long controller_get_speed()
 {
-    return state.max_speed;
+    return state.profile_speed;
 }
 
 long controller_get_accel()
 {
-    return state.accel;
+    return state.profile_accel;
 }
 
 long controller_get_decel_threshold()
@@ -107,6 +229,9 @@ bool controller_try_sleep()
         state.run_count = 0;
         return false;
     }
+    if (state.timed) {
+        _controller_end_timed_move();
+    }
     if (state.sleeping) {
         return true;
     }
@@ -120,6 +245,9 @@ bool controller_try_sleep()
 
 void controller_run()
 {
+    if (state.held) {
+        return;
+    }
     if (controller_try_sleep()) {
         return;
     }
@@ -3,12 +3,18 @@
 #include "motor.h"
 #include "constants.h"
 
+// max_speed and accel are what controller_run() moves with.
+// They're the profile's, except during a timed move, which plans its own
+// and hands the profile's back once it arrives or the target changes.
 struct controller_state_t {
   bool direction;
   int mode;
   long max_speed;
   long accel;
   long decel_denominator;
+  long profile_speed;
+  long profile_accel;
+  bool timed;
   long velocity;
   long calculated_position;
   long motor_position;
@@ -16,19 +22,32 @@ struct controller_state_t {
   long run_count;
   long sleeping;
   bool initial_position_set;
+  bool held;
 };
 
 void controller_init();
 void controller_run();
 void controller_move_to_position(long position);
+// Moves to position in duration_ms, starting from rest: the trapezoid at the
+// profile's accel whose cruise speed makes the time come out, or the
+// triangle with just enough accel when that's too slow. A move the motor
+// can't step fast enough for runs at full speed and arrives late.
+void controller_move_to_position_in(long position, unsigned int duration_ms);
 void controller_initialize_position(long position);
 void controller_uninitialize_position();
 void controller_set_speed(long speed);
 void controller_set_accel(long accel);
 long controller_get_target_position();
+long controller_get_motor_position();
+// Stops stepping where the motor is, without losing the target.
+void controller_hold(bool hold);
 long controller_get_speed();
 long controller_get_accel();
 void controller_set_mode(int mode);
+int controller_get_mode();
 bool controller_is_position_initialized();
+// True once the motor has been put to sleep at its target; controller_run()
+// has nothing to do until the next move.
+bool controller_is_asleep();
 
 #endif //lenzhound_motor_controller_h
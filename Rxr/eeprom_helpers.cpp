@@ -1,8 +1,28 @@
 
+#include <Arduino.h>
 #include <EEPROM.h>
+#include <stdint.h>
 #include "eeprom_assert.h"
 #include "eeprom_helpers.h"
 
+eeprom_stats_t eeprom_stats;
+
+void _eeprom_write_byte(int addr, uint8_t value)
+{
+  if (EEPROM.read(addr) == value) {
+    ++eeprom_stats.skipped;
+    return;
+  }
+  ++eeprom_stats.written;
+  ++eeprom_stats.block_writes[addr / EEPROM_STATS_BLOCK_SIZE];
+  EEPROM.write(addr, value);
+}
+
+void eeprom_reset_stats()
+{
+  memset(&eeprom_stats, 0, sizeof(eeprom_stats));
+}
+
 void eeprom_read_bytes(int start, char* buffer, int count)
 {
   eeprom_assert(
@@ -36,9 +56,11 @@ void eeprom_write_bytes(int start, char* buffer, int count)
     start >= EEPROM_MIN_ADDR && (start + count) <= EEPROM_MAX_ADDR,
     ERROR_WRITE_EXCEEDED_EEPROM_SIZE);
 
+  unsigned long start_us = micros();
   for (int i = 0; i < count; i++) {
-    EEPROM.write(start + i, buffer[i]);
+    _eeprom_write_byte(start + i, buffer[i]);
   }
+  eeprom_stats.write_us += micros() - start_us;
 }
 
 void eeprom_write_string(int start, char* buffer, int max_count)
@@ -47,14 +69,32 @@ void eeprom_write_string(int start, char* buffer, int max_count)
     start >= EEPROM_MIN_ADDR && (start + max_count) <= EEPROM_MAX_ADDR,
     ERROR_WRITE_EXCEEDED_EEPROM_SIZE);
 
+  unsigned long start_us = micros();
   int i = 0;
   for (; i < max_count; i++) {
-    EEPROM.write(start + i, buffer[i]);
+    _eeprom_write_byte(start + i, buffer[i]);
     if (!buffer[i]) {
       break;
     }
   }
-  EEPROM.write(start + i, 0);
+  _eeprom_write_byte(start + i, 0);
+  eeprom_stats.write_us += micros() - start_us;
+}
+
+unsigned int eeprom_crc16(int start, int count, unsigned int crc)
+{
+  eeprom_assert(
+    start >= EEPROM_MIN_ADDR && (start + count) <= EEPROM_MAX_ADDR,
+    ERROR_READ_EXCEEDED_EEPROM_SIZE);
+
+  // CRC-16/CCITT, polynomial 0x1021
+  for (int i = 0; i < count; i++) {
+    crc ^= (unsigned int)EEPROM.read(start + i) << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc & 0xffff;
 }
 
 char eeprom_read_char(int addr)
@@ -66,29 +106,29 @@ char eeprom_read_char(int addr)
 
 int eeprom_read_int16(int addr)
 {
-  int result;
-  eeprom_read_bytes(addr, (char*)&result, sizeof(int));
+  int16_t result;
+  eeprom_read_bytes(addr, (char*)&result, sizeof(result));
   return result;
 }
 
 unsigned int eeprom_read_uint16(int addr)
 {
-  unsigned int result;
-  eeprom_read_bytes(addr, (char*)&result, sizeof(unsigned int));
+  uint16_t result;
+  eeprom_read_bytes(addr, (char*)&result, sizeof(result));
   return result;
 }
 
 long eeprom_read_int32(int addr)
 {
-  long result;
-  eeprom_read_bytes(addr, (char*)&result, sizeof(long));
+  int32_t result;
+  eeprom_read_bytes(addr, (char*)&result, sizeof(result));
   return result;
 }
 
 unsigned long eeprom_read_uint32(int addr)
 {
-  unsigned long result;
-  eeprom_read_bytes(addr, (char*)&result, sizeof(unsigned long));
+  uint32_t result;
+  eeprom_read_bytes(addr, (char*)&result, sizeof(result));
   return result;
 }
 
@@ -99,33 +139,38 @@ void eeprom_write_char(int addr, char value)
 
 void eeprom_write_int16(int addr, int value)
 {
-  eeprom_write_bytes(addr, (char*)&value, sizeof(value));
+  int16_t fixed = value;
+  eeprom_write_bytes(addr, (char*)&fixed, sizeof(fixed));
 }
 
 void eeprom_write_uint16(int addr, unsigned int value)
 {
-  eeprom_write_bytes(addr, (char*)&value, sizeof(value));
+  uint16_t fixed = value;
+  eeprom_write_bytes(addr, (char*)&fixed, sizeof(fixed));
 }
 
 void eeprom_write_int32(int addr, long value)
 {
-  eeprom_write_bytes(addr, (char*)&value, sizeof(value));
+  int32_t fixed = value;
+  eeprom_write_bytes(addr, (char*)&fixed, sizeof(fixed));
 }
 
 void eeprom_write_uint32(int addr, unsigned long value)
 {
-  eeprom_write_bytes(addr, (char*)&value, sizeof(value));
+  uint32_t fixed = value;
+  eeprom_write_bytes(addr, (char*)&fixed, sizeof(fixed));
 }
 
 
 void eeprom_write_debug_string(char* buffer)
 {
   int i = DEBUG_STRING_LOC;
-  int end_i = DEBUG_STRING_LOC + DEBUG_STRING_MAX_LEN;
+  int end_i = DEBUG_STRING_LOC + DEBUG_STRING_MAX_LEN - 1;
   char* ptr = buffer;
 
   while (*ptr && i < end_i) {
-    EEPROM.write(i, *ptr);
+    _eeprom_write_byte(i++, *ptr);
     ++ptr;
   }
-}
\ No newline at end of file
+  _eeprom_write_byte(i, 0);
+}
@@ -5,6 +5,8 @@
 #define EEPROM_MIN_ADDR         0
 #define EEPROM_MAX_ADDR         899
 
+#define EEPROM_CRC16_INIT       0xffff
+
 #define DEBUG_STRING_LOC        900
 #define DEBUG_STRING_MAX_LEN    100
 
@@ -13,6 +15,8 @@
 
 void eeprom_read_bytes(int start, char* buffer, int count);
 void eeprom_read_string(int start, char* buffer, int max_count);
+// chains: pass the result of one range as crc for the next
+unsigned int eeprom_crc16(int start, int count, unsigned int crc);
 char eeprom_read_char(int addr);
 int eeprom_read_int16(int addr);
 unsigned int eeprom_read_uint16(int addr);
@@ -30,4 +34,21 @@ void eeprom_write_uint32(int addr, unsigned long value);
 
 void eeprom_write_debug_string(char* buffer);
 
+// Write accounting since boot (or the last eeprom_reset_stats()), over
+// serial as SERIAL_EEPROM_STATS. A byte that already holds the value being
+// written is skipped rather than reprogrammed.
+#define EEPROM_STATS_BLOCK_SIZE 64
+#define EEPROM_STATS_BLOCKS     16  // 1 KB / 64
+
+struct eeprom_stats_t {
+  unsigned long written;                // bytes programmed
+  unsigned long skipped;                // bytes left alone, already equal
+  unsigned long write_us;               // time spent in the write helpers
+  unsigned long block_writes[EEPROM_STATS_BLOCKS];
+};
+
+extern eeprom_stats_t eeprom_stats;
+
+void eeprom_reset_stats();
+
 #endif  // eeprom_helpers_h
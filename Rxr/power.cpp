@@ -0,0 +1,107 @@
+#include "Arduino.h"
+#include "power.h"
+#include "controller.h"
+#include "settings.h"
+
+// MUX5:0 = 011110 selects the bandgap on the 32u4; MUX5 lives in ADCSRB
+#define POWER_ADMUX_BANDGAP     (_BV(MUX4) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1))
+
+struct power_state_t {
+    unsigned int vcc_mv;
+    unsigned int baseline_mv;
+    unsigned long baseline_sum;
+    unsigned char baseline_count;
+    unsigned char run_count;    // readings in a row on the other side
+    bool measured;
+    bool drooped;
+};
+
+static power_state_t power_state = {0};
+
+void _power_start_conversion()
+{
+    ADCSRA |= _BV(ADSC);
+}
+
+void _power_droop()
+{
+    power_state.drooped = true;
+    controller_hold(true);
+
+    if (controller_is_position_initialized()) {
+        settings_save_position(controller_get_motor_position(),
+            controller_get_target_position());
+    }
+}
+
+void _power_recover()
+{
+    power_state.drooped = false;
+    settings_clear_position();
+    controller_hold(false);
+}
+
+void power_init()
+{
+    ADMUX = _BV(REFS0) | POWER_ADMUX_BANDGAP;
+    ADCSRB = 0;
+    // 16 MHz / 128, inside the 50-200 kHz the ADC wants
+    ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+    _power_start_conversion();
+}
+
+void power_run()
+{
+    if (ADCSRA & _BV(ADSC)) {
+        return;
+    }
+    unsigned int reading = ADC;
+    _power_start_conversion();
+
+    // the first conversion after switching to the bandgap is off while the
+    // reference settles
+    if (!power_state.measured) {
+        power_state.measured = true;
+        return;
+    }
+    if (!reading) {
+        return;
+    }
+    power_state.vcc_mv = (unsigned int)(POWER_BANDGAP_MV * 1023L / reading);
+
+    if (power_state.baseline_count < POWER_BASELINE_SAMPLES) {
+        power_state.baseline_sum += power_state.vcc_mv;
+        if (++power_state.baseline_count == POWER_BASELINE_SAMPLES) {
+            power_state.baseline_mv = (unsigned int)(power_state.baseline_sum /
+                POWER_BASELINE_SAMPLES);
+        }
+        return;
+    }
+
+    bool crossed;
+    if (!power_state.drooped) {
+        crossed = power_state.vcc_mv + POWER_DROOP_DROP_MV <
+            power_state.baseline_mv;
+    } else {
+        crossed = power_state.vcc_mv + POWER_RECOVER_DROP_MV >
+            power_state.baseline_mv;
+    }
+    if (!crossed) {
+        power_state.run_count = 0;
+        return;
+    }
+    if (++power_state.run_count < POWER_DROOP_SAMPLES) {
+        return;
+    }
+    power_state.run_count = 0;
+    if (!power_state.drooped) {
+        _power_droop();
+    } else {
+        _power_recover();
+    }
+}
+
+unsigned int power_get_vcc_mv()
+{
+    return power_state.vcc_mv;
+}
@@ -0,0 +1,27 @@
+#ifndef lenzhound_power_h
+#define lenzhound_power_h
+
+// the supply is watched by measuring the 1.1 V bandgap against AVcc, one
+// conversion per pass through loop(). The bandgap is only good to about
+// +-9% part to part, so the readings aren't compared against fixed
+// voltages: the first POWER_BASELINE_SAMPLES after boot are averaged into a
+// baseline, and a droop is a drop of POWER_DROOP_DROP_MV below it held for
+// POWER_DROOP_SAMPLES readings in a row, so a sag as the motor starts
+// doesn't trip it. Then the controller stops stepping and the motor and
+// target positions go to the slot in settings, so the lens mapping
+// survives a battery swap. The slot is 10 bytes, about 35 ms of EEPROM
+// writes, which the supply has to hold up for between the droop and the
+// brownout reset. If the supply comes back to within POWER_RECOVER_DROP_MV
+// of the baseline for as many readings instead, the slot is invalidated and
+// the controller carries on.
+#define POWER_BANDGAP_MV        1100L
+#define POWER_BASELINE_SAMPLES  16
+#define POWER_DROOP_SAMPLES     8
+#define POWER_DROOP_DROP_MV     400
+#define POWER_RECOVER_DROP_MV   300
+
+void power_init();
+void power_run();
+unsigned int power_get_vcc_mv();
+
+#endif // lenzhound_power_h
@@ -43,42 +43,42 @@ void _queue_print_ok(char type)
 {
     char buffer[16];
     sprintf(buffer, "OK %c", type);
-    serial_api_queue_output(buffer);
+    serial_api_queue_reply(type, buffer);
 }
 
 void _queue_print_i16(char type, int val)
 {
     char buffer[16];
     sprintf(buffer, "%c=%d", type, val);
-    serial_api_queue_output(buffer);
+    serial_api_queue_reply(type, buffer);
 }
 
 void _queue_print_i32(char type, long val)
 {
     char buffer[16];
     sprintf(buffer, "%c=%ld", type, val);
-    serial_api_queue_output(buffer);
+    serial_api_queue_reply(type, buffer);
 }
 
 void _queue_print_u16(char type, int val)
 {
     char buffer[16];
     sprintf(buffer, "%c=%u", type, val);
-    serial_api_queue_output(buffer);
+    serial_api_queue_reply(type, buffer);
 }
 
 void _queue_print_u32(char type, int val)
 {
     char buffer[16];
     sprintf(buffer, "%c=%lu", type, val);
-    serial_api_queue_output(buffer);
+    serial_api_queue_reply(type, buffer);
 }
 
 void _queue_print_string(char type, char* val)
 {
     char buffer[PACKET_STRING_LEN + 4];
     sprintf(buffer, "%c=%.*s", type, PACKET_STRING_LEN, val);
-    serial_api_queue_output(buffer);
+    serial_api_queue_reply(type, buffer);
 }
 
 void _send_ok(char key)
@@ -134,7 +134,7 @@ char _map_ok_type(char key)
     sprintf(__buffer, "%c=%s",\
             serial_cmd,\
             packet.name.val);\
-    serial_api_queue_output(__buffer);\
+    serial_api_queue_reply(serial_cmd, __buffer);\
 } while(0)
 
 void _process_packet(radio_packet_t packet)
@@ -273,6 +273,35 @@ void _process_packet(radio_packet_t packet)
         controller_uninitialize_position();
         _send_ok(type);
     } break;
+    case PACKET_TIMED_MOVE_SET: {
+        long position = i16_to_fixed(packet.timed_move_set.position);
+
+        // the target packets that follow carry the same position, and
+        // leave the move alone
+        if (!controller_is_position_initialized()) {
+            controller_initialize_position(position);
+        } else {
+            controller_move_to_position_in(position,
+                packet.timed_move_set.duration);
+        }
+
+        _queue_print_i32(SERIAL_TARGET_POSITION_GET, position);
+    } break;
+    case PACKET_AXES_TARGET_SET: {
+        int target = packet.axes_target_set.targets[radio_state.axis];
+        if (target == AXIS_TARGET_HOLD) {
+            break;
+        }
+        long position = i16_to_fixed(target);
+
+        if (!controller_is_position_initialized()) {
+            controller_initialize_position(position);
+        } else {
+            controller_move_to_position(position);
+        }
+
+        _queue_print_i32(SERIAL_TARGET_POSITION_GET, position);
+    } break;
     case PACKET_OK: {
         char ok_type = _map_ok_type(packet.ok.key);
         _queue_print_ok(ok_type);
@@ -293,11 +322,18 @@ void radio_init()
 {
     Mirf.spi = &MirfHardwareSpi;
     Mirf.init();
-    Mirf.setRADDR((uint8_t *)RECEIVE_ADDRESS);
+    radio_set_axis(settings_get_axis());
     Mirf.payload = sizeof(radio_packet_t);
 
     int channel = settings_get_channel();
     radio_set_channel(channel);
+
+    // the broadcast pipe, see RADIO_AXES; it shares the rest of its address
+    // with pipe 1 and sends no ACK
+    Mirf.configRegister(RX_ADDR_P2, BROADCAST_ADDRESS_BYTE);
+    Mirf.configRegister(RX_PW_P2, Mirf.payload);
+    Mirf.configRegister(EN_RXADDR, (1 << ERX_P0) | (1 << ERX_P1) | (1 << ERX_P2));
+    Mirf.configRegister(EN_AA, (1 << ENAA_P0) | (1 << ENAA_P1));
 }
 
 void radio_run()
@@ -346,6 +382,19 @@ void radio_set_channel(int channel)
     Mirf.config();
 }
 
+void radio_set_axis(int axis)
+{
+    uint8_t addr[mirf_ADDR_LEN];
+
+    if (axis < 0 || axis >= RADIO_AXES) {
+        axis = DEFAULT_AXIS;
+    }
+    memcpy(addr, RECEIVE_ADDRESS, mirf_ADDR_LEN);
+    addr[0] += axis;
+    Mirf.setRADDR(addr);
+    radio_state.axis = axis;
+}
+
 bool radio_is_alive()
 {
     uint8_t addr[mirf_ADDR_LEN];
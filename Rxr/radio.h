@@ -5,12 +5,26 @@
 
 #define RADIO_OUT_BUFFER_SIZE       64
 #define STRING_PACKET_BUFFER_SIZE   60
-#define RADIO_VERSION               01
+// bump with any change to a packet's layout; 02 widened the payload to 7
+// bytes for PACKET_AXES_TARGET_SET
+#define RADIO_VERSION               02
 
 #define RF_DEFAULT                  0b00100011  // 250kbps 0dB
 #define TRANSMIT_ADDRESS            "clie1"
 #define RECEIVE_ADDRESS             "serv1"
 
+// one transmitter drives up to RADIO_AXES receivers, each set to
+// an axis. A receiver listens on pipe 1 at its axis's own address, "serv1"
+// with the axis added to the first byte, for the settings and commands meant
+// for it alone, and on pipe 2 at the broadcast address. The nRF24 only gives
+// pipes 2-5 a first byte of their own, so the broadcast address is "serv1"
+// with BROADCAST_ADDRESS_BYTE first. Broadcasts go out without an ACK, as
+// every receiver answering at once would collide; the targets are resent
+// often enough not to need one.
+#define RADIO_AXES                  3   // focus, iris, zoom
+#define BROADCAST_ADDRESS_BYTE      'b'
+#define AXIS_TARGET_HOLD            (-32767 - 1)
+
 
 enum {
     PACKET_NONE                     = 0,
@@ -49,6 +63,8 @@ enum {
     PACKET_START_STATE_SET          = 33,
     PACKET_START_STATE_PRINT        = 34,
     PACKET_RE_INIT_POSITION         = 35,
+    PACKET_TIMED_MOVE_SET           = 36,
+    PACKET_AXES_TARGET_SET          = 37,
     PACKET_OK                       = 120,
 };
 
@@ -89,6 +105,22 @@ struct u32_packet_t {
     long val;
 };
 
+// saved positions are int16, which leaves room for the duration
+// in the same 6 bytes
+struct timed_move_packet_t {
+    char type;
+    int position;               // steps
+    unsigned int duration;      // ms
+};
+
+// broadcast, every axis's target in one frame, so more axes
+// don't take more airtime. Each receiver picks out its own; an axis at
+// AXIS_TARGET_HOLD stays where it is. It makes the payload 7 bytes.
+struct axes_target_packet_t {
+    char type;
+    int targets[RADIO_AXES];    // steps
+};
+
 struct radio_packet_t {
     // char version;
     union {
@@ -125,6 +157,8 @@ struct radio_packet_t {
         i16_packet_t start_state_set;
         i16_packet_t start_state_print;
         empty_packet_t re_init_position;
+        timed_move_packet_t timed_move_set;
+        axes_target_packet_t axes_target_set;
         ok_packet_t ok;
     };
 };
@@ -141,6 +175,7 @@ struct radio_state_t {
     int version_match;
     long heartbeat_sent_timestamp;
     long heartbeat_received_timestamp;
+    int axis;
 };
 
 #define PACKET_SEND_EMPTY(packet_type) do {\
@@ -167,6 +202,8 @@ void radio_init();
 void radio_run();
 void radio_queue_message(radio_packet_t packet);
 void radio_set_channel(int channel);
+// Listens at the axis's address from now on, see RADIO_AXES.
+void radio_set_axis(int axis);
 bool radio_is_alive();
 
 #endif //radio_h
@@ -21,15 +21,13 @@ inline char *_serial_api_in(int index)
 
 inline void _serial_api_print(const char *in)
 {
-    char *out = _serial_api_out(serial_api_state.out_index);
-
     while (*in) {
-        if (serial_api_state.out_index++ > SERIAL_API_OUT_BUFFER_SIZE) {
+        // a response that doesn't fit is replaced by the error
+        if (serial_api_state.out_index >= SERIAL_API_OUT_BUFFER_SIZE) {
             serial_api_state.out_index = 0;
-            out = _serial_api_out(0);
-            in = (char *)MAX_RESPONSE_LENGTH_EXCEEDED;
+            in = MAX_RESPONSE_LENGTH_EXCEEDED;
         }
-        *(out++) = *(in++);
+        *_serial_api_out(serial_api_state.out_index++) = *(in++);
     }
 }
 
@@ -48,8 +46,19 @@ inline void _serial_api_print_len(char *in, int len)
     }
 }
 
+inline void _serial_api_print_request_id()
+{
+    if (serial_api_state.request_id) {
+        char buffer[8];
+        sprintf(buffer, "%c%u ", SERIAL_API_REQUEST_ID,
+                serial_api_state.request_id);
+        _serial_api_print(buffer);
+    }
+}
+
 inline void _serial_api_end(const char *in)
 {
+    _serial_api_print_request_id();
     _serial_api_print(in);
     _serial_api_print("\n");
 }
@@ -63,6 +72,7 @@ inline void _serial_api_print_ok(char type)
 
 inline void _serial_api_end_len(char *in, int len)
 {
+    _serial_api_print_request_id();
     _serial_api_print_len(in, len);
     _serial_api_print("\n");
 }
@@ -72,35 +82,86 @@ inline void _serial_api_reset_in_buffer()
     serial_api_state.in_index = 0;
 }
 
+// Parses an optional "#<id> " prefix, returning the offset of the command
+// proper, or -1 if the prefix is malformed. Ids run from 1 to 65535; zero
+// means the command carried no id.
+int _serial_api_parse_request_id(char *in, int length)
+{
+    if (*in != SERIAL_API_REQUEST_ID) {
+        return 0;
+    }
+
+    unsigned long id = 0;
+    int i = 1;
+    while (i < length && in[i] >= '0' && in[i] <= '9' && id <= 0xffff) {
+        id = id * 10 + (in[i++] - '0');
+    }
+
+    if (i == 1 || i >= length || in[i] != ' ' || !id || id > 0xffff) {
+        return -1;
+    }
+
+    serial_api_state.request_id = (unsigned int)id;
+    return i + 1;
+}
+
+unsigned int _serial_api_take_pending(char key)
+{
+    unsigned long now = millis();
+    for (int i = 0; i < SERIAL_API_PENDING_SIZE; ++i) {
+        // start at the oldest slot so replies of the same key come back FIFO
+        int index = (serial_api_state.pending_index + i) %
+            SERIAL_API_PENDING_SIZE;
+        serial_api_pending_t *pending = &serial_api_state.pending[index];
+
+        // a reply that never came mustn't lend its id to a later line
+        if (pending->key &&
+            now - pending->millis > SERIAL_API_PENDING_TIMEOUT_MS) {
+            pending->key = 0;
+        }
+        if (pending->key == key) {
+            pending->key = 0;
+            return pending->request_id;
+        }
+    }
+    return 0;
+}
+
+// the parsers truncate like AVR int and long would, so the host
+// builds see the same values as the units
 int _parse_i16(char* in) {
-    int val;
-    sscanf(in + 2, "%d", &val);
-    return val;
+    long val = 0;
+    sscanf(in + 2, "%ld", &val);
+    return (int16_t)val;
 }
 
 long _parse_i32(char* in) {
-    long val;
+    long val = 0;
     sscanf(in + 2, "%ld", &val);
-    return val;
+    return (int32_t)val;
 }
 
 unsigned int _parse_u16(char* in) {
-    unsigned int val;
-    sscanf(in + 2, "%u", &val);
-    return val;
+    unsigned long val = 0;
+    sscanf(in + 2, "%lu", &val);
+    return (uint16_t)val;
 }
 
 unsigned long _parse_u32(char* in) {
-    unsigned long val;
+    unsigned long val = 0;
     sscanf(in + 2, "%lu", &val);
-    return val;
+    return (uint32_t)val;
 }
 
 void _print_string(char type, char* str)
 {
-    char buffer[60];
-    sprintf(buffer, "%c=%s", type, str);
-    _serial_api_end(buffer);
+    // printed in pieces, names and the debug string don't fit
+    // a small stack buffer
+    char key[3] = { type, '=', 0 };
+    _serial_api_print_request_id();
+    _serial_api_print(key);
+    _serial_api_print(str);
+    _serial_api_print("\n");
 }
 
 void _print_i16(char type, int val)
@@ -131,9 +192,8 @@ void _print_u32(char type, unsigned long val)
     _serial_api_end(buffer);
 }
 
-void _serial_api_process_command(int length)
+void _serial_api_process_command(char *in, int length)
 {
-    char *in = _serial_api_in(0);
     char cmd = *in;
     switch (cmd) {
     case (SERIAL_ECHO): {
@@ -152,9 +212,11 @@ void _serial_api_process_command(int length)
         _print_i16(cmd, ROLE);
     } break;
     case (SERIAL_REMOTE_VERSION): {
+        serial_api_expect_reply(cmd);
         PACKET_SEND_EMPTY(PACKET_VERSION_GET);
     } break;
     case (SERIAL_REMOTE_ROLE): {
+        serial_api_expect_reply(cmd);
         PACKET_SEND_EMPTY(PACKET_ROLE_GET);
     } break;
     case (SERIAL_SAVE_CONFIG): {
@@ -162,6 +224,7 @@ void _serial_api_process_command(int length)
         _serial_api_print_ok(cmd);
     } break;
     case (SERIAL_PRESET_INDEX_GET): {
+        serial_api_expect_reply(cmd);
         PACKET_SEND_EMPTY(PACKET_PRESET_INDEX_GET);
     } break;
     case (SERIAL_PRESET_INDEX_SET): {
@@ -169,12 +232,14 @@ void _serial_api_process_command(int length)
         _serial_api_print_ok(cmd);
     } break;
     case (SERIAL_ID_GET): {
+        serial_api_expect_reply(cmd);
         PACKET_SEND_EMPTY(PACKET_PROFILE_ID_GET);
     } break;
     case (SERIAL_ID_SET): {
         _serial_api_print_ok(cmd);
     } break;
     case (SERIAL_NAME_GET): {
+        serial_api_expect_reply(cmd);
         PACKET_SEND_EMPTY(PACKET_PROFILE_NAME_GET);
     } break;
     case (SERIAL_NAME_SET): {
@@ -190,6 +255,7 @@ void _serial_api_process_command(int length)
         _serial_api_print_ok(cmd);
     } break;
     case (SERIAL_REMOTE_CHANNEL_GET): {
+        serial_api_expect_reply(cmd);
         PACKET_SEND_EMPTY(PACKET_CHANNEL_GET);
     } break;
     case (SERIAL_REMOTE_CHANNEL_SET): {
@@ -198,6 +264,7 @@ void _serial_api_process_command(int length)
         _serial_api_print_ok(cmd);
     } break;
     case (SERIAL_START_STATE_GET): {
+        serial_api_expect_reply(cmd);
         PACKET_SEND_EMPTY(PACKET_START_STATE_GET);
     } break;
     case (SERIAL_START_STATE_SET): {
@@ -249,6 +316,43 @@ void _serial_api_process_command(int length)
         settings_reset_to_defaults();
         _serial_api_print_ok(cmd);
     } break;
+    case (SERIAL_EEPROM_STATS): {
+        // "k" for the totals, "k <block>" for one 64 byte block
+        int block = 0;
+        if (sscanf(in + 1, "%d", &block) == 1) {
+            if (block < 0 || block >= EEPROM_STATS_BLOCKS) {
+                _serial_api_end(MALFORMED_COMMAND);
+                break;
+            }
+            _print_u32(cmd, eeprom_stats.block_writes[block]);
+        } else {
+            char buffer[36];
+            sprintf(buffer, "%lu %lu %lu",
+                eeprom_stats.written, eeprom_stats.skipped,
+                eeprom_stats.write_us);
+            _print_string(cmd, buffer);
+        }
+    } break;
+    case (SERIAL_EEPROM_STATS_RESET): {
+        eeprom_reset_stats();
+        _serial_api_print_ok(cmd);
+    } break;
+    case (SERIAL_AXIS): {
+        // "X" for the axis this unit answers to, "X <axis>" to change it,
+        // see RADIO_AXES
+        int axis = 0;
+        if (sscanf(in + 1, "%d", &axis) == 1) {
+            if (axis < 0 || axis >= RADIO_AXES) {
+                _serial_api_end(MALFORMED_COMMAND);
+                break;
+            }
+            settings_set_axis(axis);
+            radio_set_axis(axis);
+            _serial_api_print_ok(cmd);
+        } else {
+            _print_i16(cmd, settings_get_axis());
+        }
+    } break;
     default: {
         _serial_api_end(UNKNOWN_COMMAND);
     } break;
@@ -262,8 +366,19 @@ void _serial_api_inner_queue_byte(char byte,
 
     if (byte == SERIAL_API_END_OF_COMMAND) {
         *next = 0;
-        int len = index;
-        _serial_api_process_command(len);
+        // a bare "X" still gets an empty argument at in + 2
+        if (index + 1 < SERIAL_API_IN_BUFFER_SIZE) {
+            *(next + 1) = 0;
+        }
+        char *in = _serial_api_in(0);
+        int offset = _serial_api_parse_request_id(in, index);
+
+        if (offset < 0) {
+            _serial_api_end(MALFORMED_COMMAND);
+        } else {
+            _serial_api_process_command(in + offset, index - offset);
+        }
+        serial_api_state.request_id = 0;
         _serial_api_reset_in_buffer();
     } else {
         *next = byte;
@@ -282,11 +397,11 @@ serial_api_response_t serial_api_read_response()
 
 void serial_api_queue_byte(char byte)
 {
-    int i = serial_api_state.in_index++;
-
-    if (i < SERIAL_API_IN_BUFFER_SIZE) {
-        _serial_api_inner_queue_byte(byte, i);
-    } else {
+    if (serial_api_state.in_index < SERIAL_API_IN_BUFFER_SIZE) {
+        _serial_api_inner_queue_byte(byte, serial_api_state.in_index++);
+    } else if (byte == SERIAL_API_END_OF_COMMAND) {
+        // swallow the rest of an overlong command rather than
+        // running its tail as a command of its own
         _serial_api_end(MAX_INPUT_LENGTH_EXCEEDED);
         _serial_api_reset_in_buffer();
     }
@@ -302,3 +417,25 @@ void serial_api_queue_output_len(char *message,
 {
     _serial_api_end_len(message, length);
 }
+
+void serial_api_expect_reply(char key)
+{
+    if (serial_api_state.request_id) {
+        serial_api_pending_t *pending =
+            &serial_api_state.pending[serial_api_state.pending_index++];
+        serial_api_state.pending_index %= SERIAL_API_PENDING_SIZE;
+
+        pending->key = key;
+        pending->request_id = serial_api_state.request_id;
+        pending->millis = millis();
+    }
+}
+
+void serial_api_queue_reply(char key, const char *message)
+{
+    unsigned int request_id = serial_api_state.request_id;
+
+    serial_api_state.request_id = _serial_api_take_pending(key);
+    _serial_api_end(message);
+    serial_api_state.request_id = request_id;
+}
\ No newline at end of file
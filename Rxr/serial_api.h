@@ -6,6 +6,9 @@ const int SERIAL_API_OUT_BUFFER_SIZE = 128;
 const char SERIAL_API_END_OF_RESPONSE = '\n';
 const char SERIAL_API_END_OF_COMMAND = '\n';
 const char SERIAL_API_ESCAPE = '\\';
+const char SERIAL_API_REQUEST_ID = '#';
+const int SERIAL_API_PENDING_SIZE = 8;
+const unsigned long SERIAL_API_PENDING_TIMEOUT_MS = 1000;
 
 #define MAX_RESPONSE_LENGTH_EXCEEDED "ERR 01"
 #define MAX_INPUT_LENGTH_EXCEEDED    "ERR 02"
@@ -14,11 +17,23 @@ const char SERIAL_API_ESCAPE = '\\';
 
 struct radio_state_t;
 
+// a remote command is answered whenever the radio gets around to
+// it, so we remember which request id asked for which reply key, until
+// SERIAL_API_PENDING_TIMEOUT_MS says the reply isn't coming.
+struct serial_api_pending_t {
+    char key;
+    unsigned int request_id;
+    unsigned long millis;       // when it was asked
+};
+
 struct serial_api_state_t {
     char in_buffer[SERIAL_API_IN_BUFFER_SIZE];
     char out_buffer[SERIAL_API_OUT_BUFFER_SIZE];
     int in_index;
     int out_index;
+    unsigned int request_id;
+    serial_api_pending_t pending[SERIAL_API_PENDING_SIZE];
+    int pending_index;
 };
 
 enum {
@@ -51,6 +66,9 @@ enum {
     SERIAL_TARGET_POSITION_GET  = 'o',
     SERIAL_TARGET_POSITION_SET  = 'O',
     SERIAL_FACTORY_RESET        = 'Y',
+    SERIAL_EEPROM_STATS         = 'k',
+    SERIAL_EEPROM_STATS_RESET   = 'K',
+    SERIAL_AXIS                 = 'X',
     SERIAL_IGNORE               = '_',
 };
 
@@ -77,5 +95,7 @@ void serial_api_queue_byte(char byte);
 void serial_api_queue_output(const char *message);
 void serial_api_queue_output_len(char *message,
                                  int length);
+void serial_api_expect_reply(char key);
+void serial_api_queue_reply(char key, const char *message);
 
 #endif
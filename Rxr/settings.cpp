@@ -0,0 +1,230 @@
+#include "Arduino.h"
+#include "settings.h"
+#include "controller.h"
+
+struct settings_motion_t {
+    unsigned int max_speed;
+    int accel;
+    int mode;
+    unsigned long changed_millis;
+    bool dirty;
+};
+
+// the last values seen in the controller, and when they last changed
+static settings_motion_t settings_motion = {0};
+
+unsigned int _settings_crc_over(int end)
+{
+    return eeprom_crc16(SETTINGS_START, end - SETTINGS_START,
+        EEPROM_CRC16_INIT);
+}
+
+unsigned int _settings_crc()
+{
+    return _settings_crc_over(SETTINGS_END);
+}
+
+// a migration seals the layout it brings the data up to, not SETTINGS_END,
+// so the migrations after it still find their own range checking out
+void _settings_seal_over(int end)
+{
+    eeprom_write_uint16(SETTINGS_CRC_LOC, _settings_crc_over(end));
+}
+
+void _settings_seal()
+{
+    _settings_seal_over(SETTINGS_END);
+}
+
+void _settings_write_motion_defaults()
+{
+    eeprom_write_uint16(MAX_SPEED_LOC, DEFAULT_MAX_SPEED);
+    eeprom_write_int16(ACCEL_LOC, DEFAULT_ACCEL);
+    eeprom_write_int16(MODE_LOC, DEFAULT_MODE);
+}
+
+void _settings_write_defaults()
+{
+    eeprom_write_int16(CHANNEL_LOC, DEFAULT_CHANNEL);
+    eeprom_write_int16(AXIS_LOC, DEFAULT_AXIS);
+    _settings_write_motion_defaults();
+    _settings_seal();
+}
+
+// version 0 had no checksum; what's there is all we have
+void _settings_migrate_0_to_1()
+{
+    _settings_seal_over(CHANNEL_LOC + 2);
+}
+
+// version 1 covered the channel only; keep a torn one failing its check
+void _settings_migrate_1_to_2()
+{
+    bool valid = eeprom_read_uint16(SETTINGS_CRC_LOC) ==
+        _settings_crc_over(CHANNEL_LOC + 2);
+    _settings_write_motion_defaults();
+    if (valid) {
+        _settings_seal_over(MODE_LOC + 2);
+    }
+}
+
+// version 2 ended at the mode; every unit so far was the only one, focus
+void _settings_migrate_2_to_3()
+{
+    bool valid = eeprom_read_uint16(SETTINGS_CRC_LOC) ==
+        _settings_crc_over(MODE_LOC + 2);
+    eeprom_write_int16(AXIS_LOC, DEFAULT_AXIS);
+    if (valid) {
+        _settings_seal_over(AXIS_LOC + 2);
+    }
+}
+
+typedef void (*settings_migration_t)();
+
+// settings_migrations[n] brings layout n up to n + 1
+static const settings_migration_t settings_migrations[SETTINGS_VERSION] = {
+    _settings_migrate_0_to_1,
+    _settings_migrate_1_to_2,
+    _settings_migrate_2_to_3,
+};
+
+int _settings_read_version()
+{
+    unsigned char version = eeprom_read_char(SETTINGS_VERSION_LOC);
+    return version == 0xff ? 0 : version;
+}
+
+void _settings_load_motion()
+{
+    settings_motion.max_speed = settings_get_max_speed();
+    settings_motion.accel = settings_get_accel();
+    settings_motion.mode = settings_get_mode();
+    settings_motion.dirty = false;
+}
+
+void settings_init()
+{
+    int version = _settings_read_version();
+    if (eeprom_read_uint16(SENTINEL_LOC) != SENTINEL_VALUE ||
+        version > SETTINGS_VERSION) {
+        // never initialized, or laid out by firmware newer than us
+        _settings_write_defaults();
+        eeprom_write_char(SETTINGS_VERSION_LOC, SETTINGS_VERSION);
+        eeprom_write_uint16(SENTINEL_LOC, SENTINEL_VALUE);
+    } else {
+        for (; version < SETTINGS_VERSION; ++version) {
+            settings_migrations[version]();
+            eeprom_write_char(SETTINGS_VERSION_LOC, version + 1);
+        }
+
+        if (eeprom_read_uint16(SETTINGS_CRC_LOC) != _settings_crc()) {
+            _settings_write_defaults();
+        }
+    }
+
+    _settings_load_motion();
+}
+
+void settings_reset_to_defaults()
+{
+    eeprom_write_uint16(SENTINEL_LOC, 0);
+    settings_init();
+}
+
+int settings_get_channel()
+{
+    return eeprom_read_int16(CHANNEL_LOC);
+}
+
+void settings_set_channel(int val)
+{
+    eeprom_write_int16(CHANNEL_LOC, val);
+    _settings_seal();
+}
+
+unsigned int settings_get_max_speed()
+{
+    return eeprom_read_uint16(MAX_SPEED_LOC);
+}
+
+int settings_get_accel()
+{
+    return eeprom_read_int16(ACCEL_LOC);
+}
+
+int settings_get_mode()
+{
+    return eeprom_read_int16(MODE_LOC);
+}
+
+int settings_get_axis()
+{
+    return eeprom_read_int16(AXIS_LOC);
+}
+
+void settings_set_axis(int val)
+{
+    eeprom_write_int16(AXIS_LOC, val);
+    _settings_seal();
+}
+
+unsigned int _settings_position_marker()
+{
+    return eeprom_crc16(POSITION_SLOT_LOC,
+        POSITION_MARKER_LOC - POSITION_SLOT_LOC, EEPROM_CRC16_INIT) ^
+        POSITION_MARKER;
+}
+
+void settings_save_position(long motor_position, long target_position)
+{
+    eeprom_write_int32(MOTOR_POSITION_LOC, motor_position);
+    eeprom_write_int32(TARGET_POSITION_LOC, target_position);
+    eeprom_write_uint16(POSITION_MARKER_LOC, _settings_position_marker());
+}
+
+bool settings_take_position(long* motor_position, long* target_position)
+{
+    if (eeprom_read_uint16(POSITION_MARKER_LOC) !=
+        _settings_position_marker()) {
+        return false;
+    }
+    *motor_position = eeprom_read_int32(MOTOR_POSITION_LOC);
+    *target_position = eeprom_read_int32(TARGET_POSITION_LOC);
+    settings_clear_position();
+    return true;
+}
+
+void settings_clear_position()
+{
+    unsigned int marker = _settings_position_marker();
+    if (eeprom_read_uint16(POSITION_MARKER_LOC) == marker) {
+        eeprom_write_uint16(POSITION_MARKER_LOC, ~marker);
+    }
+}
+
+void settings_run()
+{
+    unsigned int max_speed = (unsigned int)controller_get_speed();
+    int accel = (int)controller_get_accel();
+    int mode = controller_get_mode();
+
+    if (max_speed != settings_motion.max_speed ||
+        accel != settings_motion.accel ||
+        mode != settings_motion.mode) {
+        settings_motion.max_speed = max_speed;
+        settings_motion.accel = accel;
+        settings_motion.mode = mode;
+        settings_motion.changed_millis = millis();
+        settings_motion.dirty = true;
+        return;
+    }
+
+    if (settings_motion.dirty &&
+        millis() - settings_motion.changed_millis >= SETTINGS_SETTLE_MILLIS) {
+        settings_motion.dirty = false;
+        eeprom_write_uint16(MAX_SPEED_LOC, max_speed);
+        eeprom_write_int16(ACCEL_LOC, accel);
+        eeprom_write_int16(MODE_LOC, mode);
+        _settings_seal();
+    }
+}
@@ -1,4 +1,3 @@
-
 #ifndef settings_h
 #define settings_h
 
@@ -6,27 +5,65 @@
 
 // EEPROM locations for parameters
 #define DEFAULT_CHANNEL   1
+#define DEFAULT_MAX_SPEED 1
+#define DEFAULT_ACCEL     1
+#define DEFAULT_MODE      0
+#define DEFAULT_AXIS      0
 #define CHANNEL_LOC       32  // int
+#define MAX_SPEED_LOC     34  // uint16
+#define ACCEL_LOC         36  // int
+#define MODE_LOC          38  // int
+#define AXIS_LOC          40  // int, see RADIO_AXES
 #define SENTINEL_LOC      128 // int
 #define SENTINEL_VALUE    0xfafbul
 
-inline int settings_reset_to_defaults()
-{
-    eeprom_write_uint16(SENTINEL_LOC, 0);
-}
-
-inline int settings_get_channel()
-{
-    if (eeprom_read_uint16(SENTINEL_LOC) != SENTINEL_VALUE) {
-        eeprom_write_uint16(SENTINEL_LOC, SENTINEL_VALUE);
-        eeprom_write_int16(CHANNEL_LOC, DEFAULT_CHANNEL);
-        return DEFAULT_CHANNEL;
-    }
-    return eeprom_read_int16(CHANNEL_LOC);
-}
-
-inline void settings_set_channel(int val)
-{
-    return eeprom_write_int16(CHANNEL_LOC, val);
-}
+// schema header next to the sentinel. The settings region
+// carries a CRC so a write torn by a brownout falls back to defaults instead
+// of loading garbage. Units from before versioning have 0xff at
+// SETTINGS_VERSION_LOC and are migrated forward in settings_init().
+#define SETTINGS_VERSION_LOC  130 // uint8
+#define SETTINGS_VERSION      3
+#define SETTINGS_CRC_LOC      132 // uint16
+#define SETTINGS_START        CHANNEL_LOC
+#define SETTINGS_END          (AXIS_LOC + 2)
+
+// the motion settings are whatever the transmitter last sent,
+// kept so a unit powered up without a link still moves at the configured
+// speed. The transmitter resends them every 250 ms, so settings_run() only
+// writes them back once they have held still for SETTINGS_SETTLE_MILLIS.
+#define SETTINGS_SETTLE_MILLIS  5000
+
+// the motor and target positions saved on a supply droop (see
+// power.h), outside the checksummed settings. The marker is the slot's CRC
+// xored with POSITION_MARKER, written last, so a slot cut short by the
+// supply failing never checks out. A restored slot is invalidated straight
+// away; the positions are only good until the motor next moves.
+#define POSITION_SLOT_LOC     64
+#define MOTOR_POSITION_LOC    64  // long
+#define TARGET_POSITION_LOC   68  // long
+#define POSITION_MARKER_LOC   72  // uint16
+#define POSITION_MARKER       0x5a5a
+
+void settings_init();
+void settings_reset_to_defaults();
+
+int settings_get_channel();
+void settings_set_channel(int val);
+
+unsigned int settings_get_max_speed();
+int settings_get_accel();
+int settings_get_mode();
+
+int settings_get_axis();
+void settings_set_axis(int val);
+
+void settings_save_position(long motor_position, long target_position);
+// True, with the positions, when a valid slot was saved; invalidates it.
+bool settings_take_position(long* motor_position, long* target_position);
+void settings_clear_position();
+
+// Writes back the controller's speed, accel and mode once they settle.
+// Called from loop().
+void settings_run();
+
 #endif
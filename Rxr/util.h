@@ -20,12 +20,14 @@ inline long clamp32(long x, long min, long max) {
 	return min32(max, max32(min, x));
 }
 
+// multiplied rather than shifted left, which is undefined for negative
+// values; gcc emits the same shift either way
 inline long i16_to_fixed(int a) {
-  return ((long)a) << BIT_SHIFT;
+  return ((long)a) * (1L << BIT_SHIFT);
 }
 
 inline long i32_to_fixed(long a) {
-  return a << BIT_SHIFT;
+  return a * (1L << BIT_SHIFT);
 }
 
 inline int fixed_to_i16(long a) {
@@ -24,6 +24,7 @@ enum PelicanSignals {
     MAX_PUB_SIG,  // the last published signal
 
     SEND_TIMEOUT_SIG,
+    POSITION_TIMEOUT_SIG,
     FLUSH_SETTINGS_TIMEOUT_SIG,
     SPEED_AND_ACCEL_TIMEOUT_SIG,
     FLASH_RATE_SIG,
@@ -32,6 +33,30 @@ enum PelicanSignals {
 };
 
 
+// storage for AO_Txr's event queue and the PositionButtonEvt pool, see
+// Txr.ino; 'j' reports how close each has come to running out
+#define TXR_QUEUE_LEN       10
+#define SMALL_POOL_LEN      10
+
+// the 32u4 has 2560 bytes of RAM for .data, .bss and the stack.
+// Counted by hand with AVR sizes (int 2, long 4, pointers 2), the statics
+// come to about 2250 bytes:
+//   take buffer and coder (take.h)              407
+//   serial API buffers, pending ids and log     408
+//   EEPROM write queue and stats                176
+//   radio queue and axis targets (radio.h)      132
+//   calibration table                           122
+//   settings mirror                             114
+//   the sketch's other statics                   95
+//   string literals                            ~200
+//   AO_Txr, its queue and pool, QF             ~340
+//   USB serial, Mirf, vtables, the core        ~250
+// That leaves about 300 bytes of stack. The deepest path, a serial command
+// formatting its reply with the Timer4 ISR stacked on top, needs about 200
+// of them, so anything added here has to come out of something else. The
+// Q_SPY build does just that: its QS trace buffer and QS's own state come
+// out of the take's share, and bsp.cpp won't build if they outgrow it.
+
 struct PositionButtonEvt : public QP::QEvt
 {
   char ButtonNum;
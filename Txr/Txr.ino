@@ -22,10 +22,10 @@
 
 
 // Local-scope objects -------------------------------------------------------
-static QEvt const *txrQueueSto[10];
+static QEvt const *txrQueueSto[TXR_QUEUE_LEN];
 static QSubscrList subscrSto[MAX_PUB_SIG];
 
-static QF_MPOOL_EL(PositionButtonEvt) smlPoolSto[10]; // storage for the small event pool
+static QF_MPOOL_EL(PositionButtonEvt) smlPoolSto[SMALL_POOL_LEN]; // storage for the small event pool
 
 //............................................................................
 void setup() {
@@ -18,6 +18,9 @@
 #include "console.h"
 #include "settings.h"
 #include "leds.h"
+#include "pot_filter.h"
+#include "take.h"
+#include "calibration.h"
 
 Q_DEFINE_THIS_FILE
 
@@ -29,8 +32,16 @@ Q_DEFINE_THIS_FILE
 
 // various timeouts in ticks
 enum TxrTimeouts {
-    // how often to send encoder position
+    // how often to read the encoder and update the LEDs
     SEND_ENCODER_TOUT  = BSP_TICKS_PER_SEC / 100,
+    // how often to sample the position while it's moving, and at rest
+    POSITION_MOVING_TOUT = 1,
+    POSITION_RESTING_TOUT = SEND_ENCODER_TOUT,
+    // how long the position has to hold still to count as resting
+    POSITION_SETTLE_TOUT = BSP_TICKS_PER_SEC / 8,
+    // how often an unchanged position is sent anyway, in case the packet
+    // that ended a move was lost
+    POSITION_KEEP_ALIVE_TOUT = BSP_TICKS_PER_SEC / 2,
     // how quick to flash LED
     FLASH_RATE_TOUT = BSP_TICKS_PER_SEC / 3,
     // how long to be flashing LED for
@@ -73,14 +84,16 @@ private:
     QTimeEvt alive_timeout_;
     QTimeEvt flash_timeout_;
     QTimeEvt send_timeout_;
+    QTimeEvt position_timeout_;
     QTimeEvt speed_and_accel_timeout_;
     QTimeEvt flush_settings_timeout_;
     QTimeEvt calibration_timeout_;
     QTimeEvt double_tap_timeout_;
     long play_back_target_pos_;
     long cur_pos_;    // float to save partial moves needed by encoder resolution division
-    long prev_pos_1_;   // used to prevent jitter
-    long prev_pos_2_;   // used to prevent jitter
+    int position_interval_;     // ticks between position samples
+    int ticks_since_send_;
+    int ticks_since_change_;
     long initial_encoder_count_;
     long initial_position_;
     long previous_encoder_count_;
@@ -88,6 +101,11 @@ private:
     long calibration_pos_2_;
     char enc_pushes_;
     char calibration_multiplier_;
+    // the points between the ends while calibrating, pot ascending
+    int calibration_points_;
+    int calibration_point_pots_[CAL_MAX_INNER_POINTS];
+    int calibration_point_positions_[CAL_MAX_INNER_POINTS];
+    bool more_calibration_points_;
     long saved_positions_[NUM_POSITION_BUTTONS];
     unsigned char prev_position_button_pressed_;
     long encoder_base_;
@@ -102,12 +120,16 @@ public:
         QActive((QStateHandler) & Txr::initial),
         flash_timeout_(FLASH_RATE_SIG),
         send_timeout_(SEND_TIMEOUT_SIG),
+        position_timeout_(POSITION_TIMEOUT_SIG),
         flush_settings_timeout_(FLUSH_SETTINGS_TIMEOUT_SIG),
         speed_and_accel_timeout_(SPEED_AND_ACCEL_TIMEOUT_SIG),
         calibration_timeout_(CALIBRATION_SIG),
         alive_timeout_(ALIVE_SIG),
         double_tap_timeout_(DOUBLE_TAP_SIG),
         play_back_target_pos_(0),
+        position_interval_(POSITION_RESTING_TOUT),
+        ticks_since_send_(0),
+        ticks_since_change_(0),
         previous_preset_index_(0),
         previous_channel_(0),
         double_tapping_(false),
@@ -126,6 +148,8 @@ protected:
     static QP::QState z_mode(Txr *const me, QP::QEvt const *const e);
 
     void update_position();
+    void send_position(bool changed);
+    void schedule_position();
     void update_position_calibration();
     void update_position_play_back();
     void update_max_speed_using_encoder();
@@ -133,6 +157,10 @@ protected:
     void update_calibration_multiplier(int setting);
     void update_button_LEDs();
     void reset_calibration();
+    void add_calibration_point();
+    bool check_calibration_points();
+    void load_calibration();
+    void run_take();
 };
 
 static Txr l_Txr;                   // the single instance of Txr active object (local)
@@ -165,8 +193,8 @@ void Txr::update_button_LEDs()
         button_leds[2] = map_accel_LED(factor, 24);
         button_leds[3] = map_accel_LED(factor, 32);
 
-        analogWrite(SPEED_LED3_1, encoder_led / 4);
-        analogWrite(SPEED_LED3_2, min(DIMLY_LIT_ENCODER_VAL + encoder_led, 64) / 4);
+        led_pwm_write(SPEED_LED3_1, encoder_led / 4);
+        led_pwm_write(SPEED_LED3_2, min(DIMLY_LIT_ENCODER_VAL + encoder_led, 64) / 4);
     } else {
 
         int factor = (int)((long)settings_get_max_speed() * 100L / 32768L);
@@ -178,18 +206,14 @@ void Txr::update_button_LEDs()
         button_leds[2] = map_speed_LED(factor, 75);
         button_leds[3] = map_speed_LED(factor, 100);
 
-        analogWrite(SPEED_LED3_1, min(DIMLY_LIT_ENCODER_VAL + encoder_led, 64) / 4);
-        analogWrite(SPEED_LED3_2, encoder_led / 4);
+        led_pwm_write(SPEED_LED3_1, min(DIMLY_LIT_ENCODER_VAL + encoder_led, 64) / 4);
+        led_pwm_write(SPEED_LED3_2, encoder_led / 4);
     }
 
     if (BSP_get_mode() == Z_MODE) {
         int preset = settings_get_preset_index();
         int* led = &button_leds[preset];
-        float ms = (float)millis();
-
-        // arbitrary constants here to get the desired period.
-        int factor = (int)((sin(ms / 500.0f) + 1.0f) * 128.0f);
-        *led = map(factor, 0, 256, max(1, *led), 16);
+        *led = map(led_breathe(millis()), 0, 256, max(1, *led), 16);
     }
 
     if (flashing_position_button_) {
@@ -201,10 +225,10 @@ void Txr::update_button_LEDs()
         }
     }
 
-    analogWrite(SPEED_LED1, button_leds[0]);
-    analogWrite(SPEED_LED2, button_leds[1]);
-    analogWrite(SPEED_LED4, button_leds[2]);
-    analogWrite(SPEED_LED5, button_leds[3]);
+    led_pwm_write(SPEED_LED1, button_leds[0]);
+    led_pwm_write(SPEED_LED2, button_leds[1]);
+    led_pwm_write(SPEED_LED4, button_leds[2]);
+    led_pwm_write(SPEED_LED5, button_leds[3]);
 }
 
 void Txr::reset_calibration()
@@ -213,6 +237,87 @@ void Txr::reset_calibration()
     initial_position_ = cur_pos_;
 }
 
+// a point is taken where the pot is now; one close to a point
+// already taken replaces it, so a mark can be taken again. One close to two
+// points is dropped, it would leave whichever it replaced too close to the
+// other.
+void Txr::add_calibration_point()
+{
+    pot_filter_reset(BSP_get_pot());
+    long pot = pot_filter_output();
+    if (pot - MIN_POT_VAL < CALIBRATION_MIN_SPAN ||
+        MAX_POT_VAL - pot < CALIBRATION_MIN_SPAN) {
+        return;
+    }
+
+    int i = 0;
+    while (i < calibration_points_ &&
+           calibration_point_pots_[i] + CALIBRATION_MIN_SPAN <= pot) {
+        ++i;
+    }
+    if (i == calibration_points_ ||
+        calibration_point_pots_[i] - CALIBRATION_MIN_SPAN >= pot) {
+        if (calibration_points_ == CAL_MAX_INNER_POINTS) {
+            return;
+        }
+        for (int j = calibration_points_; j > i; --j) {
+            calibration_point_pots_[j] = calibration_point_pots_[j - 1];
+            calibration_point_positions_[j] = calibration_point_positions_[j - 1];
+        }
+        ++calibration_points_;
+    } else if (i + 1 < calibration_points_ &&
+               calibration_point_pots_[i + 1] - CALIBRATION_MIN_SPAN < pot) {
+        return;
+    }
+    calibration_point_pots_[i] = pot;
+    calibration_point_positions_[i] = cur_pos_;
+}
+
+// builds the mapping from the two ends and count points in between
+static bool _build_calibration(long position_1, long position_2, int count,
+                               const int* point_pots,
+                               const int* point_positions)
+{
+    long pots[CALIBRATION_MAX_POINTS];
+    long positions[CALIBRATION_MAX_POINTS];
+
+    pots[0] = MIN_POT_VAL;
+    positions[0] = position_1;
+    for (int i = 0; i < count; ++i) {
+        pots[1 + i] = point_pots[i];
+        positions[1 + i] = point_positions[i];
+    }
+    pots[1 + count] = MAX_POT_VAL;
+    positions[1 + count] = position_2;
+    return calibration_build(pots, positions, count + 2);
+}
+
+// the points just taken, false when they don't make a mapping with the ends
+bool Txr::check_calibration_points()
+{
+    return _build_calibration(calibration_pos_1_, calibration_pos_2_,
+        calibration_points_, calibration_point_pots_,
+        calibration_point_positions_);
+}
+
+void Txr::load_calibration()
+{
+    int pots[CAL_MAX_INNER_POINTS];
+    int positions[CAL_MAX_INNER_POINTS];
+    int count = settings_get_calibration_point_count();
+    long position_1 = settings_get_calibration_position_1();
+    long position_2 = settings_get_calibration_position_2();
+
+    for (int i = 0; i < count; ++i) {
+        settings_get_calibration_point(i, &pots[i], &positions[i]);
+    }
+
+    // points that no longer fit the ends fall back to the ends alone
+    if (!_build_calibration(position_1, position_2, count, pots, positions)) {
+        _build_calibration(position_1, position_2, 0, pots, positions);
+    }
+}
+
 void Txr::update_position_calibration()
 {
     long cur_encoder_count = BSP_get_encoder();
@@ -286,26 +391,70 @@ void Txr::update_max_accel_using_encoder()
 
 void Txr::update_position()
 {
-    long new_pos = BSP_get_pot();
-
-    // only update the current position if it's not jittering between two values
-    if (new_pos != prev_pos_1_ && new_pos != prev_pos_2_) {
+    // only moves when the filtered pot has left its dead-band
+    bool changed = pot_filter_run(BSP_get_pot());
+    if (changed) {
+        long new_pos = pot_filter_output();
         log_value(SERIAL_POT_GET, new_pos);
 
-        prev_pos_1_ = prev_pos_2_;
-        prev_pos_2_ = new_pos;
-        cur_pos_ = map(new_pos, MIN_POT_VAL, MAX_POT_VAL,
-                          calibration_pos_1_, calibration_pos_2_);
-
-        PACKET_SEND(PACKET_TARGET_POSITION_SET, target_position_set, cur_pos_);
+        cur_pos_ = calibration_map(new_pos);
     }
+    send_position(changed);
 }
 
 void Txr::update_position_play_back()
 {
-    if (play_back_target_pos_ != cur_pos_) {
-        cur_pos_ = play_back_target_pos_;
-        PACKET_SEND(PACKET_TARGET_POSITION_SET, target_position_set, cur_pos_);
+    bool changed = play_back_target_pos_ != cur_pos_;
+    cur_pos_ = play_back_target_pos_;
+    send_position(changed);
+}
+
+// called once per position sample. A change goes out on the
+// sample that sees it, so the closest two packets can be is one tick
+// (POSITION_MOVING_TOUT). While the position moves it is sampled every
+// tick; once it has held still for POSITION_SETTLE_TOUT the sampling drops
+// back to the encoder rate and the only packets are the keep-alives. It
+// goes out as the knob's axis in the broadcast of every axis's target,
+// which the radio doesn't retransmit, so the last position is repeated on
+// every sample until it settles: a lost packet costs a tick, not a
+// keep-alive.
+void Txr::send_position(bool changed)
+{
+    ticks_since_send_ += position_interval_;
+    if (changed) {
+        ticks_since_change_ = 0;
+    } else if (ticks_since_change_ < POSITION_SETTLE_TOUT) {
+        ticks_since_change_ += position_interval_;
+    }
+
+    if (ticks_since_change_ < POSITION_SETTLE_TOUT ||
+            ticks_since_send_ >= POSITION_KEEP_ALIVE_TOUT) {
+        radio_set_axis_target(RADIO_KNOB_AXIS, cur_pos_);
+        radio_send_axis_targets();
+        ticks_since_send_ = 0;
+    }
+
+    position_interval_ = ticks_since_change_ < POSITION_SETTLE_TOUT ?
+        POSITION_MOVING_TOUT : POSITION_RESTING_TOUT;
+    schedule_position();
+}
+
+void Txr::schedule_position()
+{
+    position_timeout_.postIn(this, position_interval_);
+}
+
+// once per SEND_TIMEOUT_SIG in every calibrated mode, so a take
+// is sampled and replayed on the same 128 Hz grid. A replay only exists in
+// play-back mode (serial_api.cpp won't start one anywhere else, and leaving
+// stops it), where its samples stand in for the position buttons.
+void Txr::run_take()
+{
+    long pos;
+    if (take_next(&pos)) {
+        play_back_target_pos_ = pos;
+    } else {
+        take_sample(cur_pos_);
     }
 }
 
@@ -327,10 +476,31 @@ void Txr::update_calibration_multiplier(int setting)
 
 QP::QState Txr::initial(Txr *const me, QP::QEvt const *const e)
 {
+    QS_OBJ_DICTIONARY(&l_Txr);
+    QS_FUN_DICTIONARY(&Txr::on);
+    QS_FUN_DICTIONARY(&Txr::uncalibrated);
+    QS_FUN_DICTIONARY(&Txr::calibrated);
+    QS_FUN_DICTIONARY(&Txr::flashing);
+    QS_FUN_DICTIONARY(&Txr::free_run_mode);
+    QS_FUN_DICTIONARY(&Txr::play_back_mode);
+    QS_FUN_DICTIONARY(&Txr::z_mode);
+    QS_SIG_DICTIONARY(ENC_DOWN_SIG, (void *)0);
+    QS_SIG_DICTIONARY(ENC_UP_SIG, (void *)0);
+    QS_SIG_DICTIONARY(PLAY_BACK_MODE_SIG, (void *)0);
+    QS_SIG_DICTIONARY(FREE_RUN_MODE_SIG, (void *)0);
+    QS_SIG_DICTIONARY(Z_MODE_SIG, (void *)0);
+    QS_SIG_DICTIONARY(POSITION_BUTTON_SIG, (void *)0);
+    QS_SIG_DICTIONARY(ALIVE_SIG, (void *)0);
+    QS_SIG_DICTIONARY(SEND_TIMEOUT_SIG, (void *)0);
+    QS_SIG_DICTIONARY(POSITION_TIMEOUT_SIG, (void *)0);
+    QS_SIG_DICTIONARY(FLUSH_SETTINGS_TIMEOUT_SIG, (void *)0);
+    QS_SIG_DICTIONARY(SPEED_AND_ACCEL_TIMEOUT_SIG, (void *)0);
+    QS_SIG_DICTIONARY(FLASH_RATE_SIG, (void *)0);
+    QS_SIG_DICTIONARY(CALIBRATION_SIG, (void *)0);
+    QS_SIG_DICTIONARY(DOUBLE_TAP_SIG, (void *)0);
+
     me->calibration_multiplier_ = 1;
     me->reset_calibration();
-    me->prev_pos_1_ = -1;
-    me->prev_pos_2_ = -1;
     me->subscribe(ENC_DOWN_SIG);
     me->subscribe(ENC_UP_SIG);
     me->subscribe(PLAY_BACK_MODE_SIG);
@@ -338,15 +508,15 @@ QP::QState Txr::initial(Txr *const me, QP::QEvt const *const e)
     me->subscribe(Z_MODE_SIG);
     me->subscribe(POSITION_BUTTON_SIG);
     me->send_timeout_.postEvery(me, SEND_ENCODER_TOUT);
+    me->schedule_position();
     me->flush_settings_timeout_.postEvery(me, FLUSH_SETTINGS_TOUT);
     me->alive_timeout_.postEvery(me, ALIVE_DURATION_TOUT);
     me->speed_and_accel_timeout_.postEvery(me, SEND_SPEED_AND_ACCEL_TOUT);
-    me->calibration_pos_1_ = settings_get_calibration_position_1();
-    me->calibration_pos_2_ = settings_get_calibration_position_2();
+    me->load_calibration();
     me->previous_channel_ = settings_get_channel();
 
-    long pos = map(BSP_get_pot(), MIN_POT_VAL, MAX_POT_VAL,
-        me->calibration_pos_1_, me->calibration_pos_2_);
+    pot_filter_reset(BSP_get_pot());
+    long pos = calibration_map(pot_filter_output());
     me->cur_pos_ = pos;
     me->initial_position_ = pos;
 
@@ -404,6 +574,13 @@ QP::QState Txr::on(Txr *const me, QP::QEvt const *const e)
             settings_flush_debounced_values();
             status = Q_HANDLED();
         } break;
+        case POSITION_TIMEOUT_SIG: {
+            // nothing sends the position from here, keep the timer going
+            // for the states that do
+            me->position_interval_ = POSITION_RESTING_TOUT;
+            me->schedule_position();
+            status = Q_HANDLED();
+        } break;
         default: {
             status = Q_SUPER(&QP::QHsm::top);
         } break;
@@ -420,8 +597,13 @@ QP::QState Txr::uncalibrated(Txr *const me, QP::QEvt const *const e)
             set_LED_status(ENC_RED_LED, LED_ON);
             set_LED_status(ENC_GREEN_LED, LED_OFF);
             me->update_calibration_multiplier(BSP_get_mode());
+            // the motor's zero moves with PACKET_RE_INIT_POSITION, a recording
+            // or a replay can't carry on through it
+            take_stop();
             me->cur_pos_ = 0;
             me->reset_calibration();
+            me->calibration_points_ = 0;
+            me->more_calibration_points_ = false;
             PACKET_SEND_EMPTY(PACKET_RE_INIT_POSITION);
 
             status = Q_HANDLED();
@@ -434,17 +616,31 @@ QP::QState Txr::uncalibrated(Txr *const me, QP::QEvt const *const e)
             status = Q_HANDLED();
         } break;
         case ENC_DOWN_SIG: {
+            // counted up to the first point in between, so it can't wrap
+            char push = me->enc_pushes_;
+            if (push < 3) {
+                ++(me->enc_pushes_);
+            }
             // if this is first time button press, just save the position
-            if ((me->enc_pushes_)++ == 0) {
+            if (push == 0) {
                 me->calibration_pos_1_ = me->cur_pos_;
                 settings_set_calibration_position_1(me->calibration_pos_1_);
+                // the old points in between don't go with the new ends
+                settings_set_calibration_points(0, 0, 0);
             }
             // if this is second time, determine whether swapping is necessary
             // to map higher calibrated position with higher motor position
-            else {
+            else if (push == 1) {
                 me->calibration_pos_2_ = me->cur_pos_;
                 settings_set_calibration_position_2(me->calibration_pos_2_);
             }
+            // past the ends, a point in between at the pot's mark
+            else {
+                me->add_calibration_point();
+                if (me->calibration_points_ == CAL_MAX_INNER_POINTS) {
+                    me->more_calibration_points_ = false;
+                }
+            }
             status = Q_TRAN(&flashing);
         } break;
         case PLAY_BACK_MODE_SIG: {
@@ -493,6 +689,7 @@ QP::QState Txr::calibrated(Txr *const me, QP::QEvt const *const e)
         } break;
         case DOUBLE_TAP_SIG: {
             me->double_tapping_ = false;
+            status = Q_HANDLED();
         } break;
         case ENC_DOWN_SIG: {
             status = Q_HANDLED();
@@ -519,6 +716,7 @@ QP::QState Txr::calibrated(Txr *const me, QP::QEvt const *const e)
         } break;
         case CALIBRATION_SIG: {
             // we've held for ENTER_CALIBRATION_TOUT, go to calibration
+            status = Q_HANDLED();
         } break;
         default: {
             status = Q_SUPER(&on);
@@ -546,8 +744,18 @@ QP::QState Txr::flashing(Txr *const me, QP::QEvt const *const e)
             status = Q_HANDLED();
         } break;
         case CALIBRATION_SIG: {
-            // if they've pressed button 2 times calibration should be complete
-            if (me->enc_pushes_ >= 2) {
+            // if they've pressed button 2 times calibration should be complete,
+            // unless they asked for points in between
+            if (me->enc_pushes_ >= 2 && !me->more_calibration_points_) {
+                // points that don't make a mapping with the ends aren't
+                // saved, else every boot falls back to the ends alone
+                if (!me->check_calibration_points()) {
+                    me->calibration_points_ = 0;
+                }
+                settings_set_calibration_points(me->calibration_points_,
+                    me->calibration_point_pots_,
+                    me->calibration_point_positions_);
+                me->load_calibration();
                 if (FREESWITCH_ON()) {
                     status = Q_TRAN(&free_run_mode);
                 } else if (ZSWITCH_ON()) {
@@ -564,8 +772,15 @@ QP::QState Txr::flashing(Txr *const me, QP::QEvt const *const e)
             status = Q_HANDLED();
         } break;
         case ENC_DOWN_SIG: {
-            // here to swallow the encoder press while flashing; else an exception
-            // occurs
+            // a second press while it flashes goes on to points
+            // between the ends after the second end, and ends the points
+            // after one of them; other than that it's swallowed here, else
+            // an exception occurs
+            if (me->enc_pushes_ == 2) {
+                me->more_calibration_points_ = true;
+            } else if (me->enc_pushes_ > 2) {
+                me->more_calibration_points_ = false;
+            }
             status = Q_HANDLED();
         } break;
         default: {
@@ -597,10 +812,14 @@ QP::QState Txr::free_run_mode(Txr *const me, QP::QEvt const *const e)
                 me->update_max_accel_using_encoder();
             }
             me->update_button_LEDs();
-            me->update_position();
+            me->run_take();
 
             status = Q_HANDLED();
         } break;
+        case POSITION_TIMEOUT_SIG: {
+            me->update_position();
+            status = Q_HANDLED();
+        } break;
         case POSITION_BUTTON_SIG: {
             // only save position if finished flashing from previous save
             if (me->flash_timeout_.ctr() == 0) {
@@ -642,6 +861,9 @@ QP::QState Txr::play_back_mode(Txr *const me, QP::QEvt const *const e)
         case Q_EXIT_SIG: {
             set_speed_LEDs_off();
             me->flash_timeout_.disarm();
+            if (take_replaying()) {
+                take_stop();
+            }
             status = Q_HANDLED();
         } break;
         case SEND_TIMEOUT_SIG: {
@@ -652,14 +874,33 @@ QP::QState Txr::play_back_mode(Txr *const me, QP::QEvt const *const e)
             }
 
             me->update_button_LEDs();
-
+            me->run_take();
+            status = Q_HANDLED();
+        } break;
+        case POSITION_TIMEOUT_SIG: {
             me->update_position_play_back();
             status = Q_HANDLED();
         } break;
         case POSITION_BUTTON_SIG: {
             int button_num = ((PositionButtonEvt *)e)->ButtonNum;
             Q_REQUIRE(button_num < NUM_POSITION_BUTTONS);
+            // a button takes the motor back from a replay
+            if (take_replaying()) {
+                take_stop();
+            }
             me->play_back_target_pos_ = me->saved_positions_[button_num];
+            // a timed preset goes out ahead of the target packet
+            // update_position_play_back() sends for it, so the receiver has
+            // planned the move before it starts. It's sent once, the radio
+            // retries it until the receiver acks it.
+            unsigned int duration = settings_get_saved_duration(button_num);
+            if (duration && me->play_back_target_pos_ != me->cur_pos_) {
+                radio_packet_t packet = {0};
+                packet.timed_move_set.type = PACKET_TIMED_MOVE_SET;
+                packet.timed_move_set.position = me->play_back_target_pos_;
+                packet.timed_move_set.duration = duration;
+                radio_queue_message(packet);
+            }
             me->prev_position_button_pressed_ = button_num;
             me->flashing_position_button_ = true;
             // disarm first in case a previous flash is in progress
@@ -703,7 +944,6 @@ QP::QState Txr::z_mode(Txr *const me, QP::QEvt const *const e)
                 me->update_max_accel_using_encoder();
             }
             me->update_button_LEDs();
-            me->update_position();
 
             int preset_index = settings_get_preset_index();
             if (preset_index != me->previous_preset_index_) {
@@ -711,9 +951,14 @@ QP::QState Txr::z_mode(Txr *const me, QP::QEvt const *const e)
                 set_speed_LED_status(preset_index, LED_ON);
                 me->previous_preset_index_ = preset_index;
             }
+            me->run_take();
 
             status = Q_HANDLED();
         } break;
+        case POSITION_TIMEOUT_SIG: {
+            me->update_position();
+            status = Q_HANDLED();
+        } break;
         case POSITION_BUTTON_SIG: {
             int button_index = ((PositionButtonEvt *)e)->ButtonNum;
             Q_REQUIRE(button_index < NUM_POSITION_BUTTONS);
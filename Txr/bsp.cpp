@@ -18,11 +18,12 @@
 #include "console.h"
 #include "serial_api.h"
 #include "settings.h"
+#include "take.h"
 
 
 Q_DEFINE_THIS_FILE
 
-//#define SAVE_POWER
+#define SAVE_POWER
 
 #define TICK_DIVIDER       ((F_CPU / BSP_TICKS_PER_SEC / 1024) - 1)
 
@@ -37,8 +38,45 @@ static int prev_button_state_ = 0;
 static int prev_mode_state_ = -1;    // force signal on startup with -1
 static int prev_position_state_ = 0; // position buttons
 
+// A0 is ADC7 on the 32u4
+#define POT_ADMUX   (_BV(REFS0) | 7)
+
+struct pot_state_t {
+    uint32_t sum;
+    uint8_t samples;
+    volatile uint16_t value;    // decimated, POT_BITS wide
+};
+
+static pot_state_t pot_state_;
+
+// time asleep in QF::onIdle(), since BSP_idle_permille() last read it
+struct idle_state_t {
+    unsigned long asleep_us;
+    unsigned long since_us;
+    volatile bool ticked;       // Timer4 has run since onIdle went to sleep
+};
+
+static idle_state_t idle_state_;
+
 #ifdef Q_SPY
 uint8_t l_TIMER2_COMPA;
+
+// in the Q_SPY build the serial port carries the binary QS trace
+// instead of the serial API. Records land in this ring from wherever QP
+// emits them and QF::onIdle() ships them out; host/qspy/qs_latency turns the
+// stream into a per-signal latency report.
+#define QS_BUFFER_SIZE     192
+#define QS_DRAIN_CHUNK     32
+// QS's own filters, object pointers and ring state
+#define QS_STATE_SIZE      64
+
+// the trace lives in the room the take has in the normal build, so the RAM
+// budget in Txr.h holds for both
+#if TAKE_BUFFER_SIZE + QS_BUFFER_SIZE + QS_STATE_SIZE > TAKE_RAM_SHARE
+#   error the QS trace buffer doesn't fit the RAM budget
+#endif
+
+static uint8_t qs_buffer_[QS_BUFFER_SIZE];
 #endif
 
 #define RATE_MASK     0b00101000
@@ -52,12 +90,30 @@ uint8_t l_TIMER2_COMPA;
 #define PALEVEL_0     0b00000011
 
 // ISRs ----------------------------------------------------------------------
+ISR(ADC_vect) {
+    // free running, so the next conversion is already under way
+    pot_state_.sum += ADC;
+    if (++pot_state_.samples == POT_OVERSAMPLE) {
+        pot_state_.value = pot_state_.sum >> (POT_BITS - 10);
+        pot_state_.sum = 0;
+        pot_state_.samples = 0;
+        // end of the burst; the conversion under way finishes unheard and
+        // the next tick starts another
+        ADCSRA &= ~(_BV(ADATE) | _BV(ADIE));
+    }
+}
+
 ISR(TIMER4_COMPA_vect) {
     // No need to clear the interrupt source since the Timer4 compare
     // interrupt is automatically cleard in hardware when the ISR runs.
 
     QF::TICK(&l_TIMER2_COMPA);                // process all armed time events
 
+    // one burst of POT_OVERSAMPLE conversions a tick, 1.7 ms of them; writing
+    // ADIF back clears the flag the last burst's trailing conversion left
+    ADCSRA |= _BV(ADSC) | _BV(ADATE) | _BV(ADIE);
+    idle_state_.ticked = true;
+
     // Check state of buttons
     int button_state = CALBUTTON_ON();
 
@@ -129,6 +185,7 @@ void BSP_init(void)
     // init Console
     Serial.begin(57600);
 
+    eeprom_init();
     settings_init();
 
     radio_init();
@@ -140,11 +197,19 @@ void BSP_init(void)
     // White LED stays on always
     WHITE_LED_ON();
 
-    //if (QS_INIT((void *)0) == 0) {       // initialize the QS software tracing
-    //    Q_ERROR();
-    //}
+    // one blocking read so BSP_get_pot() has a value before the first
+    // decimated one, then hand the ADC to ADC_vect: 16 MHz / 128, free
+    // running for a burst from each Timer4 tick
+    pot_state_.value = analogRead(A0) << (POT_BITS - 10);
+    ADMUX = POT_ADMUX;
+    ADCSRB = 0;
+    ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
 
-    //QS_OBJ_DICTIONARY(&l_SysTick_Handler);
+    if (QS_INIT((void *)0) == 0) {       // initialize the QS software tracing
+        Q_ERROR();
+    }
+
+    QS_OBJ_DICTIONARY(&l_TIMER2_COMPA);
 }
 
 //............................................................................
@@ -167,6 +232,24 @@ void QF::onCleanup(void)
 //............................................................................
 void QF::onIdle()
 {
+#ifdef Q_SPY
+    radio_run();
+
+    // copy out under the lock, write with interrupts back on
+    uint8_t block[QS_DRAIN_CHUNK];
+    int length = 0;
+    uint16_t b;
+    while (length < QS_DRAIN_CHUNK && (b = QS::getByte()) != QS_EOD) {
+        block[length++] = (uint8_t)b;
+    }
+    QF_INT_ENABLE();
+
+    if (length) {
+        BSP_serial_write((char *)block, length);
+    }
+    return;
+#endif
+
     console_run();
     radio_run();
     
@@ -175,13 +258,41 @@ void QF::onIdle()
 
 #ifdef SAVE_POWER
 
-    SMCR = (0 << SM0) | (1 << SE); // idle sleep mode, adjust to your project
+    // idle sleep only stops the CPU clock. Timer4, the ADC, USB,
+    // EE_READY and the encoder's pin interrupts all wake it, and whatever
+    // they post is dispatched straight after, so the position path waits no
+    // longer than it would spinning. The nRF24's IRQ line isn't wired to an
+    // interrupt though, so while packets are queued behind the one on the
+    // air we keep polling rather than leave them until the next tick.
+    //
+    // Only the tick posts events, and only a byte from the host gives the
+    // console anything to do, so every other wake (the ADC's 16 a tick,
+    // USB's start of frame each millisecond) goes straight back to sleep
+    // without polling the console or the radio.
+    if (radio_busy()) {
+        QF_INT_ENABLE();
+        return;
+    }
+
+    idle_state_.ticked = false;
+    for (;;) {
+        unsigned long start_us = micros();
+
+        SMCR = (0 << SM0) | (1 << SE); // idle sleep mode, adjust to your project
 
-    // never separate the following two assembly instructions, see NOTE2
-    __asm__ __volatile__ ("sei" "\n\t" :: );
-    __asm__ __volatile__ ("sleep" "\n\t" :: );
+        // never separate the following two assembly instructions, see NOTE2
+        __asm__ __volatile__ ("sei" "\n\t" :: );
+        __asm__ __volatile__ ("sleep" "\n\t" :: );
 
-    SMCR = 0;                                            // clear the SE bit
+        SMCR = 0;                                        // clear the SE bit
+
+        QF_INT_DISABLE();
+        idle_state_.asleep_us += micros() - start_us;
+        if (idle_state_.ticked || BSP_serial_available()) {
+            break;
+        }
+    }
+    QF_INT_ENABLE();
 
 #else
     QF_INT_ENABLE();
@@ -195,7 +306,11 @@ long BSP_get_encoder()
 
 int BSP_get_pot()
 {
-    return analogRead(A0);
+    uint8_t sreg = SREG;
+    cli();
+    int value = pot_state_.value;
+    SREG = sreg;
+    return value;
 }
 
 int BSP_get_mode()
@@ -213,42 +328,6 @@ int BSP_get_mode()
     }
 }
 
-void BSP_turn_on_speed_LED(char num)
-{
-    switch (num) {
-    case 0:
-        RED_LED_ON();
-        break;
-    case 1:
-        analogWrite(SPEED_LED2, 255);
-        break;
-    case 2:
-        analogWrite(SPEED_LED4, 255);
-        break;
-    case 3:
-        GREEN_LED_ON();
-        break;
-    }
-}
-
-void BSP_turn_off_speed_LED(char num)
-{
-    switch (num) {
-    case 0:
-        RED_LED_OFF();
-        break;
-    case 1:
-        analogWrite(SPEED_LED2, 0);
-        break;
-    case 2:
-        analogWrite(SPEED_LED4, 0);
-        break;
-    case 3:
-        GREEN_LED_OFF();
-        break;
-    }
-}
-
 bool BSP_serial_available()
 {
     return Serial.available() > 0;
@@ -270,6 +349,7 @@ void BSP_assert(bool condition)
     {
         QF_INT_DISABLE();                                // disable all interrupts
         AMBER_LED_ON();                                  // GREEN LED permanently ON
+        eeprom_flush();                                  // keep queued settings
         // AMBER_LED_ON();
         // AMBER2_LED_ON();
         asm volatile ("jmp 0x0000"); 
@@ -281,6 +361,71 @@ unsigned long BSP_millis()
     return millis();
 }
 
+unsigned int BSP_idle_permille()
+{
+    // only touched from QF::onIdle(), where console_run() calls this from
+    unsigned long now_us = micros();
+    unsigned long elapsed_ms = (now_us - idle_state_.since_us) / 1000;
+    unsigned long asleep_us = idle_state_.asleep_us;
+    idle_state_.asleep_us = 0;
+    idle_state_.since_us = now_us;
+
+    return elapsed_ms ? (unsigned int)(asleep_us / elapsed_ms) : 0;
+}
+
+void BSP_get_qf_usage(bsp_qf_usage_t *usage)
+{
+    // QP keeps the low-water marks itself (nMin), we only read
+    // them. AO_Txr is started at priority 1 and the PositionButtonEvt pool
+    // is the first and only one, see Txr.ino.
+    usage->queue_len = TXR_QUEUE_LEN;
+    usage->queue_min_free = QF::getQueueMargin(1U);
+    usage->pool_len = SMALL_POOL_LEN;
+    usage->pool_min_free = QF::getPoolMargin(1U);
+}
+
+#ifdef Q_SPY
+//............................................................................
+bool QS::onStartup(void const *arg)
+{
+    initBuf(qs_buffer_, sizeof(qs_buffer_));
+
+    // just what the latency report needs; everything else would crowd the
+    // ring for nothing
+    QS_FILTER_ON(QS_QEP_DISPATCH);
+    QS_FILTER_ON(QS_QEP_TRAN);
+    QS_FILTER_ON(QS_QEP_INTERN_TRAN);
+    QS_FILTER_ON(QS_QEP_IGNORED);
+    QS_FILTER_ON(QS_QF_ACTIVE_POST_FIFO);
+    QS_FILTER_ON(QS_QF_ACTIVE_POST_LIFO);
+    QS_FILTER_ON(QS_SIG_DIC);
+    QS_FILTER_ON(QS_OBJ_DIC);
+    QS_FILTER_ON(QS_FUN_DIC);
+
+    return true;
+}
+
+//............................................................................
+void QS::onCleanup(void)
+{
+}
+
+//............................................................................
+void QS::onFlush(void)
+{
+    uint16_t b;
+    while ((b = getByte()) != QS_EOD) {
+        Serial.write((uint8_t)b);
+    }
+}
+
+//............................................................................
+QSTimeCtr QS::onGetTime(void)
+{
+    return micros();
+}
+#endif
+
 //............................................................................
 void Q_onAssert(char const *const module, int location)   
 {
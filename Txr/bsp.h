@@ -14,7 +14,16 @@
 
 #include <avr/io.h>   // AVR I/O
 
-#define MAX_POT_VAL           1024
+// the pot is read by the ADC in the background and oversampled:
+// each Timer4 tick starts a burst of POT_OVERSAMPLE 10 bit conversions,
+// which are summed and decimated to POT_BITS, so BSP_get_pot() returns
+// instantly with 2 more bits than a single analogRead(). Every extra bit
+// costs 4x the samples; at the 9.6 kHz conversion rate 16 samples take
+// 1.7 ms, so a result is ready for every 256 Hz tick the position is sampled
+// at while it moves, and the ADC leaves the CPU asleep the rest of the tick.
+#define POT_BITS              12
+#define POT_OVERSAMPLE        (1 << (2 * (POT_BITS - 10)))
+#define MAX_POT_VAL           (1L << POT_BITS)
 #define MIN_POT_VAL           0
 #define NUM_POSITION_BUTTONS  4
 
@@ -89,13 +98,26 @@ void BSP_init(void);
 long BSP_get_encoder();
 int BSP_get_pot();
 int BSP_get_mode();
-void BSP_turn_on_speed_LED(char num);
-void BSP_turn_off_speed_LED(char num);
 bool BSP_serial_available();
 char BSP_serial_read();
 int BSP_serial_write(char* buffer, int length);
 void BSP_assert(bool condition);
 unsigned long BSP_millis();
+// Share of the time since the previous call spent asleep in QF::onIdle(),
+// in 1/1000ths.
+unsigned int BSP_idle_permille();
+
+// How close the framework has come to running out of event storage: the
+// size of AO_Txr's queue and of the event pool, and the fewest entries each
+// has had free since reset. QP asserts when either runs out.
+struct bsp_qf_usage_t {
+    int queue_len;
+    int queue_min_free;
+    int pool_len;
+    int pool_min_free;
+};
+
+void BSP_get_qf_usage(bsp_qf_usage_t *usage);
 
 /////////////////////////////////////////////////////////////////////
 // NOTE: The CPU clock frequency F_CPU is defined externally for each
@@ -0,0 +1,73 @@
+#include "bsp.h"
+#include "calibration.h"
+
+// segment i runs from pots[i] to pots[i + 1]; the last entry
+// only ends the one before it
+struct calibration_state_t {
+    int count;
+    long pots[CALIBRATION_MAX_POINTS];
+    long positions[CALIBRATION_MAX_POINTS];
+    long slopes[CALIBRATION_MAX_POINTS];    // position per pot count
+};
+
+static calibration_state_t calibration_state = {
+    2,
+    { MIN_POT_VAL, MAX_POT_VAL },
+    { DEFAULT_CAL_POS_1, DEFAULT_CAL_POS_2 },
+    { ((long)(DEFAULT_CAL_POS_2 - DEFAULT_CAL_POS_1) << CALIBRATION_SLOPE_SHIFT) /
+        (MAX_POT_VAL - MIN_POT_VAL) },
+};
+
+bool calibration_build(const long* pots, const long* positions, int count)
+{
+    if (count < 2 || count > CALIBRATION_MAX_POINTS ||
+        pots[0] != MIN_POT_VAL || pots[count - 1] != MAX_POT_VAL) {
+        return false;
+    }
+    for (int i = 1; i < count; ++i) {
+        if (pots[i] - pots[i - 1] < CALIBRATION_MIN_SPAN) {
+            return false;
+        }
+    }
+
+    calibration_state_t* s = &calibration_state;
+    s->count = count;
+    for (int i = 0; i < count; ++i) {
+        s->pots[i] = pots[i];
+        s->positions[i] = positions[i];
+    }
+    for (int i = 0; i < count - 1; ++i) {
+        long span = pots[i + 1] - pots[i];
+        long rise = (positions[i + 1] - positions[i]) << CALIBRATION_SLOPE_SHIFT;
+        // rounded to nearest, either sign
+        s->slopes[i] = (rise + (rise < 0 ? -span : span) / 2) / span;
+    }
+    return true;
+}
+
+long calibration_map(long pot)
+{
+    calibration_state_t* s = &calibration_state;
+    if (pot < MIN_POT_VAL) {
+        pot = MIN_POT_VAL;
+    } else if (pot > MAX_POT_VAL) {
+        pot = MAX_POT_VAL;
+    }
+
+    // the last segment whose start is at or below pot
+    int low = 0;
+    int high = s->count - 2;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (s->pots[mid] <= pot) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    long offset = (pot - s->pots[low]) * s->slopes[low];
+    return s->positions[low] +
+        ((offset + (1L << (CALIBRATION_SLOPE_SHIFT - 1))) >>
+         CALIBRATION_SLOPE_SHIFT);
+}
@@ -0,0 +1,28 @@
+#ifndef calibration_h
+#define calibration_h
+
+#include "settings.h"
+
+// maps the filtered pot to a motor position through the
+// calibration points, straight lines between them. A lens focus scale is
+// far from linear, so the two ends alone leave the marks in the middle of
+// the throw off; the points in between pull them back on. The slope of
+// each segment is worked out once, in CALIBRATION_SLOPE_SHIFT fixed point,
+// so the lookup done on every pot sample is a binary search and a multiply
+// with no division.
+//
+// A segment spans at most MAX_POT_VAL counts and 16 bits of position, so
+// slope * counts stays inside 16 + CALIBRATION_SLOPE_SHIFT bits.
+#define CALIBRATION_MAX_POINTS      (2 + CAL_MAX_INNER_POINTS)
+#define CALIBRATION_SLOPE_SHIFT     14
+// closest two points can be, in pot counts
+#define CALIBRATION_MIN_SPAN        16
+
+// Builds the segment table from count points, pot ascending from
+// MIN_POT_VAL to MAX_POT_VAL. False, leaving the table alone, when they
+// don't, or are closer than CALIBRATION_MIN_SPAN.
+bool calibration_build(const long* pots, const long* positions, int count);
+// The pot is clamped to MIN_POT_VAL..MAX_POT_VAL.
+long calibration_map(long pot);
+
+#endif // calibration_h
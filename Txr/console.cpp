@@ -11,6 +11,7 @@ void console_run()
         console_state.failing_to_write = 0;
     }
 
+    serial_api_flush_log();
     serial_api_response_t response = serial_api_read_response();
 
     int index = 0;
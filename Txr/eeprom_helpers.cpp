@@ -1,17 +1,209 @@
 
+#include <Arduino.h>
 #include <EEPROM.h>
+#include <stdint.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
 #include "eeprom_assert.h"
 #include "eeprom_helpers.h"
 
+// programming a cell takes ~3.3 ms, so writes are queued and
+// the EE_READY interrupt programs one byte each time the EEPROM goes idle.
+// The queue is strictly FIFO: bytes land in the order they were written,
+// which the settings log relies on to survive a power loss.
+//
+// Writing never waits on the EEPROM. A byte is compared against the newest
+// queued value for its cell, and otherwise against the cell itself only once
+// it reaches the head of the queue, when the EEPROM is idle and can be read.
+// The byte being programmed stays at the head until it's done, so reads find
+// every byte not yet in the EEPROM in the queue, newest entry wins. Only a
+// read of a cell that isn't queued has to wait for the EEPROM, and a read of
+// several cells holds the queue (eeprom_hold()), so it waits for one byte at
+// most.
+//
+// Anything that has to wait for the queue (a full queue, eeprom_flush())
+// programs the next byte itself instead of waiting on the interrupt, so it
+// still makes progress with interrupts masked, e.g. from an assert.
+struct eeprom_queue_t {
+  uint16_t addr[EEPROM_QUEUE_SIZE];
+  uint8_t value[EEPROM_QUEUE_SIZE];
+  uint8_t head;           // oldest entry
+  uint8_t count;
+  bool programming;       // the head entry is being programmed
+  uint8_t held;           // reads going on, start no more bytes
+};
+
+static volatile eeprom_queue_t eeprom_queue;
+eeprom_stats_t eeprom_stats;
+
+// returns with interrupts locked and no byte being programmed
+uint8_t _eeprom_lock_idle()
+{
+  unsigned long start_us = micros();
+  for (;;) {
+    uint8_t sreg = SREG;
+    cli();
+    if (!(EECR & _BV(EEPE))) {
+      eeprom_stats.wait_us += micros() - start_us;
+      return sreg;
+    }
+    SREG = sreg;
+  }
+}
+
+// call locked and idle
+void _eeprom_program_next()
+{
+  if (eeprom_queue.programming) {
+    eeprom_queue.programming = false;
+    eeprom_queue.head = (eeprom_queue.head + 1) & (EEPROM_QUEUE_SIZE - 1);
+    --eeprom_queue.count;
+  }
+
+  while (eeprom_queue.count && !eeprom_queue.held) {
+    uint8_t head = eeprom_queue.head;
+    int addr = eeprom_queue.addr[head];
+    uint8_t value = eeprom_queue.value[head];
+    if (EEPROM.read(addr) != value) {
+      ++eeprom_stats.written;
+      ++eeprom_stats.block_writes[addr / EEPROM_STATS_BLOCK_SIZE];
+      EEPROM.write(addr, value);
+      eeprom_queue.programming = true;
+      return;
+    }
+    ++eeprom_stats.skipped;
+    eeprom_queue.head = (head + 1) & (EEPROM_QUEUE_SIZE - 1);
+    --eeprom_queue.count;
+  }
+  EECR &= ~_BV(EERIE);
+}
+
+ISR(EE_READY_vect)
+{
+  _eeprom_program_next();
+}
+
+// call locked; the newest queued value for addr
+bool _eeprom_find_queued(int addr, uint8_t* value)
+{
+  for (int i = eeprom_queue.count; i > 0; --i) {
+    uint8_t index = (eeprom_queue.head + i - 1) & (EEPROM_QUEUE_SIZE - 1);
+    if (eeprom_queue.addr[index] == addr) {
+      *value = eeprom_queue.value[index];
+      return true;
+    }
+  }
+  return false;
+}
+
+void eeprom_hold()
+{
+  uint8_t sreg = SREG;
+  cli();
+  ++eeprom_queue.held;
+  SREG = sreg;
+}
+
+void eeprom_release()
+{
+  uint8_t sreg = SREG;
+  cli();
+  --eeprom_queue.held;
+  if (!eeprom_queue.held && eeprom_queue.count) {
+    EECR |= _BV(EERIE);
+  }
+  SREG = sreg;
+}
+
+// call held
+uint8_t _eeprom_read_byte(int addr)
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint8_t value;
+  if (!_eeprom_find_queued(addr, &value)) {
+    SREG = sreg;
+    sreg = _eeprom_lock_idle();
+    value = EEPROM.read(addr);
+  }
+  SREG = sreg;
+  return value;
+}
+
+void _eeprom_write_byte(int addr, uint8_t value)
+{
+  for (;;) {
+    uint8_t sreg = SREG;
+    cli();
+    uint8_t queued;
+    if (_eeprom_find_queued(addr, &queued) && queued == value) {
+      ++eeprom_stats.skipped;
+      SREG = sreg;
+      return;
+    }
+    if (eeprom_queue.count < EEPROM_QUEUE_SIZE) {
+      uint8_t tail =
+        (eeprom_queue.head + eeprom_queue.count) & (EEPROM_QUEUE_SIZE - 1);
+      eeprom_queue.addr[tail] = addr;
+      eeprom_queue.value[tail] = value;
+      ++eeprom_queue.count;
+      EECR |= _BV(EERIE);
+      SREG = sreg;
+      return;
+    }
+    SREG = sreg;
+
+    sreg = _eeprom_lock_idle();
+    _eeprom_program_next();
+    SREG = sreg;
+  }
+}
+
+void eeprom_init()
+{
+  eeprom_queue.head = 0;
+  eeprom_queue.count = 0;
+  eeprom_queue.programming = false;
+  eeprom_queue.held = 0;
+  EECR &= ~_BV(EERIE);
+}
+
+void eeprom_flush()
+{
+  // an assert can land in the middle of a read
+  eeprom_queue.held = 0;
+  for (;;) {
+    uint8_t sreg = _eeprom_lock_idle();
+    if (!eeprom_queue.count) {
+      SREG = sreg;
+      return;
+    }
+    _eeprom_program_next();
+    SREG = sreg;
+  }
+}
+
+int eeprom_pending()
+{
+  return eeprom_queue.count;
+}
+
+void eeprom_reset_stats()
+{
+  memset(&eeprom_stats, 0, sizeof(eeprom_stats));
+}
+
 void eeprom_read_bytes(int start, unsigned char* buffer, int count)
 {
   eeprom_assert(
     start >= EEPROM_MIN_ADDR && (start + count) <= EEPROM_MAX_ADDR,
     ERROR_READ_EXCEEDED_EEPROM_SIZE);
 
+  eeprom_hold();
   for (int i = 0; i < count; i++) {
-    buffer[i] = EEPROM.read(start + i);
+    buffer[i] = _eeprom_read_byte(start + i);
   }
+  eeprom_release();
 }
 
 void eeprom_read_string(int start, char* buffer, int max_count)
@@ -20,14 +212,16 @@ void eeprom_read_string(int start, char* buffer, int max_count)
     start >= EEPROM_MIN_ADDR && (start + max_count) <= EEPROM_MAX_ADDR,
     ERROR_READ_EXCEEDED_EEPROM_SIZE);
 
+  eeprom_hold();
   int i = 0;
   for (; i < max_count; i++) {
-    buffer[i] = EEPROM.read(start + i);
+    buffer[i] = _eeprom_read_byte(start + i);
     if (!buffer[i]) {
       break;
     }
   }
   buffer[i] = 0;
+  eeprom_release();
 }
 
 void eeprom_write_bytes(int start, unsigned char* buffer, int count)
@@ -37,7 +231,7 @@ void eeprom_write_bytes(int start, unsigned char* buffer, int count)
     ERROR_WRITE_EXCEEDED_EEPROM_SIZE);
 
   for (int i = 0; i < count; i++) {
-    EEPROM.write(start + i, buffer[i]);
+    _eeprom_write_byte(start + i, buffer[i]);
   }
 }
 
@@ -49,12 +243,30 @@ void eeprom_write_string(int start, char* buffer, int max_count)
 
   int i = 0;
   for (; i < max_count; i++) {
-    EEPROM.write(start + i, buffer[i]);
+    _eeprom_write_byte(start + i, buffer[i]);
     if (!buffer[i]) {
       break;
     }
   }
-  EEPROM.write(start + i, 0);
+  _eeprom_write_byte(start + i, 0);
+}
+
+unsigned int eeprom_crc16(int start, int count, unsigned int crc)
+{
+  eeprom_assert(
+    start >= EEPROM_MIN_ADDR && (start + count) <= EEPROM_MAX_ADDR,
+    ERROR_READ_EXCEEDED_EEPROM_SIZE);
+
+  // CRC-16/CCITT, polynomial 0x1021
+  eeprom_hold();
+  for (int i = 0; i < count; i++) {
+    crc ^= (unsigned int)_eeprom_read_byte(start + i) << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  eeprom_release();
+  return crc & 0xffff;
 }
 
 char eeprom_read_char(int addr)
@@ -66,29 +278,29 @@ char eeprom_read_char(int addr)
 
 int eeprom_read_int16(int addr)
 {
-  int result;
-  eeprom_read_bytes(addr, (unsigned char*)&result, sizeof(int));
+  int16_t result;
+  eeprom_read_bytes(addr, (unsigned char*)&result, sizeof(result));
   return result;
 }
 
 unsigned int eeprom_read_uint16(int addr)
 {
-  unsigned int result;
-  eeprom_read_bytes(addr, (unsigned char*)&result, sizeof(unsigned int));
+  uint16_t result;
+  eeprom_read_bytes(addr, (unsigned char*)&result, sizeof(result));
   return result;
 }
 
 long eeprom_read_int32(int addr)
 {
-  long result;
-  eeprom_read_bytes(addr, (unsigned char*)&result, sizeof(long));
+  int32_t result;
+  eeprom_read_bytes(addr, (unsigned char*)&result, sizeof(result));
   return result;
 }
 
 unsigned long eeprom_read_uint32(int addr)
 {
-  unsigned long result;
-  eeprom_read_bytes(addr, (unsigned char*)&result, sizeof(unsigned long));
+  uint32_t result;
+  eeprom_read_bytes(addr, (unsigned char*)&result, sizeof(result));
   return result;
 }
 
@@ -99,44 +311,54 @@ void eeprom_write_char(int addr, char value)
 
 void eeprom_write_int16(int addr, int value)
 {
-  eeprom_write_bytes(addr, (unsigned char*)&value, sizeof(value));
+  int16_t fixed = value;
+  eeprom_write_bytes(addr, (unsigned char*)&fixed, sizeof(fixed));
 }
 
 void eeprom_write_uint16(int addr, unsigned int value)
 {
-  eeprom_write_bytes(addr, (unsigned char*)&value, sizeof(value));
+  uint16_t fixed = value;
+  eeprom_write_bytes(addr, (unsigned char*)&fixed, sizeof(fixed));
 }
 
 void eeprom_write_int32(int addr, long value)
 {
-  eeprom_write_bytes(addr, (unsigned char*)&value, sizeof(value));
+  int32_t fixed = value;
+  eeprom_write_bytes(addr, (unsigned char*)&fixed, sizeof(fixed));
 }
 
 void eeprom_write_uint32(int addr, unsigned long value)
 {
-  eeprom_write_bytes(addr, (unsigned char*)&value, sizeof(value));
+  uint32_t fixed = value;
+  eeprom_write_bytes(addr, (unsigned char*)&fixed, sizeof(fixed));
 }
 
 void eeprom_write_debug_string(char* buffer)
 {
   int i = DEBUG_STRING_LOC;
-  int end_i = DEBUG_STRING_LOC + DEBUG_STRING_MAX_LEN;
+  int end_i = DEBUG_STRING_LOC + DEBUG_STRING_MAX_LEN - 1;
   char* ptr = buffer;
 
   while (*ptr && i < end_i) {
-    EEPROM.write(i, *ptr);
+    _eeprom_write_byte(i++, *ptr);
     ++ptr;
   }
+  _eeprom_write_byte(i, 0);
+
+  // the callers are about to reset
+  eeprom_flush();
 }
 
 void eeprom_read_debug_string(char* buffer)
 {
   int i = DEBUG_STRING_LOC;
-  int end_i = DEBUG_STRING_LOC + DEBUG_STRING_MAX_LEN;
+  int end_i = DEBUG_STRING_LOC + DEBUG_STRING_MAX_LEN - 1;
   char* ptr = buffer;
 
-  while (*ptr && i < end_i) {
-    *ptr = EEPROM.read(i);
+  eeprom_hold();
+  while (i < end_i && (*ptr = _eeprom_read_byte(i++))) {
     ++ptr;
   }
-}
\ No newline at end of file
+  *ptr = 0;
+  eeprom_release();
+}
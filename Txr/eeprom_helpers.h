@@ -5,14 +5,20 @@
 #define EEPROM_MIN_ADDR         0
 #define EEPROM_MAX_ADDR         899
 
+#define EEPROM_CRC16_INIT       0xffff
+
 #define DEBUG_STRING_LOC        900
 #define DEBUG_STRING_MAX_LEN    100
 
+#define EEPROM_QUEUE_SIZE       32  // power of 2
+
 //#define EEPROM_MIN_ADDR  0;
 //#define EEPROM_MAX_ADDR  1023;
 
 void eeprom_read_bytes(int start, unsigned char* buffer, int count);
 void eeprom_read_string(int start, char* buffer, int max_count);
+// chains: pass the result of one range as crc for the next
+unsigned int eeprom_crc16(int start, int count, unsigned int crc);
 char eeprom_read_char(int addr);
 int eeprom_read_int16(int addr);
 unsigned int eeprom_read_uint16(int addr);
@@ -28,7 +34,40 @@ void eeprom_write_uint16(int addr, unsigned int value);
 void eeprom_write_int32(int addr, long value);
 void eeprom_write_uint32(int addr, unsigned long value);
 
+// Writes are queued and programmed in the background (eeprom_helpers.cpp).
+// eeprom_flush() returns once every queued byte is in the EEPROM; call it
+// before anything that may lose power or reset. eeprom_init() starts the
+// queue empty, as a reset leaves it, and with EERIE off, which a jump to
+// the reset vector doesn't clear.
+void eeprom_init();
+void eeprom_flush();
+int eeprom_pending();
+// Starts no more queued bytes until the matching eeprom_release(), so a run
+// of reads waits for the EEPROM once at most. They nest; nothing may be
+// written while held, a full queue would never drain.
+void eeprom_hold();
+void eeprom_release();
+
 void eeprom_write_debug_string(char* buffer);
 void eeprom_read_debug_string(char* buffer);
 
+// Write accounting since boot (or the last eeprom_reset_stats()), over
+// serial as SERIAL_EEPROM_STATS. A byte that already holds the value being
+// written is skipped rather than reprogrammed. wait_us is the time callers
+// spent held up by the EEPROM: reads of cells that aren't queued, a full
+// queue and eeprom_flush().
+#define EEPROM_STATS_BLOCK_SIZE 64
+#define EEPROM_STATS_BLOCKS     16  // 1 KB / 64
+
+struct eeprom_stats_t {
+  unsigned long written;                // bytes programmed
+  unsigned long skipped;                // bytes left alone, already equal
+  unsigned long wait_us;                // time spent waiting on the EEPROM
+  unsigned long block_writes[EEPROM_STATS_BLOCKS];
+};
+
+extern eeprom_stats_t eeprom_stats;
+
+void eeprom_reset_stats();
+
 #endif  // eeprom_helpers_h
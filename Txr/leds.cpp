@@ -0,0 +1,48 @@
+#include "Arduino.h"
+#include <avr/pgmspace.h>
+#include "leds.h"
+
+// every PWM LED pin is below this
+#define LED_PWM_PINS        12
+
+// one period of (sin + 1) * 128, what update_button_LEDs() used
+// to work out in soft float every 10 ms
+static const uint8_t led_breathe_table[LED_BREATHE_STEPS] PROGMEM = {
+    128, 140, 152, 165, 176, 188, 199, 209,
+    218, 226, 234, 240, 246, 250, 253, 255,
+    255, 255, 253, 250, 246, 240, 234, 226,
+    218, 209, 199, 188, 176, 165, 152, 140,
+    128, 115, 103,  90,  79,  67,  56,  46,
+     37,  29,  21,  15,   9,   5,   2,   0,
+      0,   0,   2,   5,   9,  15,  21,  29,
+     37,  46,  56,  67,  79,  90, 103, 115,
+};
+
+// the value last written to each pin plus one, 0 when unknown
+static unsigned int led_pwm[LED_PWM_PINS];
+
+void led_pwm_write(int pin, int value)
+{
+    if (pin < LED_PWM_PINS) {
+        if (led_pwm[pin] == (unsigned int)value + 1) {
+            return;
+        }
+        led_pwm[pin] = value + 1;
+    }
+    analogWrite(pin, value);
+}
+
+void led_pwm_forget(int pin)
+{
+    if (pin < LED_PWM_PINS) {
+        led_pwm[pin] = 0;
+    }
+}
+
+int led_breathe(unsigned long ms)
+{
+    // LED_BREATHE_STEPS steps of 1024 / 21 ms, a 3.1 s period like the old
+    // sin(ms / 500)
+    int step = (int)((ms * 21) >> 10) & (LED_BREATHE_STEPS - 1);
+    return pgm_read_byte(&led_breathe_table[step]);
+}
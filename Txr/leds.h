@@ -11,11 +11,21 @@ enum {
     LED_TOGGLE
 };
 
+#define LED_BREATHE_STEPS   64  // power of 2
+
+// analogWrite(), skipped when the pin already holds value. Anything that
+// drives a PWM pin some other way has to led_pwm_forget() it.
+void led_pwm_write(int pin, int value);
+void led_pwm_forget(int pin);
+// 0..255 breathing waveform at ms
+int led_breathe(unsigned long ms);
+
 // NOTE(doug): this exists to make it easier in the future to shoot out events
 // for these LEDs to the API, to make the UI prettier if we want to.
 inline void set_LED_status(int led, int status)
 {
     log_value(SERIAL_LEDS, ((status & 0xff) << 8) | (led & 0xff));
+    led_pwm_forget(led);
     if (status == LED_ON) {
         switch (led) {
         case SPEED_LED1: {
@@ -120,12 +130,12 @@ inline void set_speed_LED_status(int led, int status)
 
 inline void set_speed_LEDs_off()
 {
-    analogWrite(SPEED_LED1, 0);
-    analogWrite(SPEED_LED2, 0);
-    analogWrite(SPEED_LED3_1, 0);
-    analogWrite(SPEED_LED3_2, 0);
-    analogWrite(SPEED_LED4, 0);
-    analogWrite(SPEED_LED5, 0);
+    led_pwm_write(SPEED_LED1, 0);
+    led_pwm_write(SPEED_LED2, 0);
+    led_pwm_write(SPEED_LED3_1, 0);
+    led_pwm_write(SPEED_LED3_2, 0);
+    led_pwm_write(SPEED_LED4, 0);
+    led_pwm_write(SPEED_LED5, 0);
 
     set_speed_LED_status(0, LED_OFF);
     set_speed_LED_status(1, LED_OFF);
@@ -0,0 +1,74 @@
+#include "pot_filter.h"
+
+struct pot_filter_state_t {
+    pot_filter_params_t params;
+    long value;     // filtered, in 1/256 pot counts
+    long speed;     // smoothed |change| per sample, in 1/256 pot counts
+    long output;
+    bool reported;  // the output has been handed out since the reset
+};
+
+static pot_filter_state_t pot_filter_state = {
+    { POT_FILTER_MIN_ALPHA, POT_FILTER_BETA, POT_FILTER_DEAD_BAND },
+    0, 0, 0, false
+};
+
+long _pot_filter_abs(long val)
+{
+    return val < 0 ? -val : val;
+}
+
+void pot_filter_reset(long raw)
+{
+    pot_filter_state.value = raw * POT_FILTER_ONE;
+    pot_filter_state.speed = 0;
+    pot_filter_state.output = raw;
+    pot_filter_state.reported = false;
+}
+
+bool pot_filter_run(long raw)
+{
+    pot_filter_state_t* s = &pot_filter_state;
+
+    long delta = raw * POT_FILTER_ONE - s->value;
+    // the speed is smoothed too, or a single noisy sample would open the
+    // filter up
+    s->speed += (_pot_filter_abs(delta) - s->speed) / 4;
+
+    long alpha = s->params.min_alpha + s->params.beta * s->speed /
+        POT_FILTER_ONE;
+    if (alpha > POT_FILTER_ONE) {
+        alpha = POT_FILTER_ONE;
+    }
+    s->value += delta * alpha / POT_FILTER_ONE;
+
+    long filtered = (s->value + POT_FILTER_ONE / 2) / POT_FILTER_ONE;
+    if (s->reported &&
+        _pot_filter_abs(filtered - s->output) <= s->params.dead_band) {
+        return false;
+    }
+    s->output = filtered;
+    s->reported = true;
+    return true;
+}
+
+long pot_filter_output()
+{
+    return pot_filter_state.output;
+}
+
+pot_filter_params_t pot_filter_get_params()
+{
+    return pot_filter_state.params;
+}
+
+bool pot_filter_set_params(pot_filter_params_t params)
+{
+    if (params.min_alpha < 1 || params.min_alpha > POT_FILTER_ONE ||
+        params.beta < 0 || params.beta > POT_FILTER_ONE ||
+        params.dead_band < 0 || params.dead_band > POT_FILTER_ONE) {
+        return false;
+    }
+    pot_filter_state.params = params;
+    return true;
+}
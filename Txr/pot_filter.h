@@ -0,0 +1,38 @@
+#ifndef pot_filter_h
+#define pot_filter_h
+
+// sits between BSP_get_pot() and the map() to calibration space.
+// An exponential filter whose weight grows with how fast the pot is moving,
+// the idea behind the 1-euro filter: held still or pulled slowly it averages
+// hard and the ADC noise goes away, pulled fast it follows with almost no
+// lag. The output then only moves once the filtered value has left a
+// dead-band around it, so a resting pot sends no packets at all.
+//
+// Weights are in 1/256ths, run once per position sample (256 Hz while the
+// pot moves, see Txr::send_position()):
+//   min_alpha  weight of a new sample when the pot is at rest
+//   beta       weight added per pot count per sample of speed
+//   dead_band  pot counts the output holds against
+#define POT_FILTER_ONE              256
+#define POT_FILTER_MIN_ALPHA        10
+#define POT_FILTER_BETA             20
+#define POT_FILTER_DEAD_BAND        2
+
+struct pot_filter_params_t {
+    int min_alpha;
+    int beta;
+    int dead_band;
+};
+
+// Starts over at raw, without filtering up to it.
+void pot_filter_reset(long raw);
+// Feeds one reading in; true when the output moved, and on the first
+// reading after a reset.
+bool pot_filter_run(long raw);
+long pot_filter_output();
+
+pot_filter_params_t pot_filter_get_params();
+// False, leaving the parameters alone, when one is out of range.
+bool pot_filter_set_params(pot_filter_params_t params);
+
+#endif // pot_filter_h
@@ -32,7 +32,18 @@ bool _get_radio_packet(void *buffer)
 
 void _send_radio_packet(void *buffer)
 {
-    Mirf.setTADDR((uint8_t *)TRANSMIT_ADDRESS);
+    // unicast packets go to the knob's axis and are acknowledged, see
+    // RADIO_AXES; the broadcast isn't
+    uint8_t addr[mirf_ADDR_LEN];
+    memcpy(addr, TRANSMIT_ADDRESS, mirf_ADDR_LEN);
+    if (((radio_packet_t *)buffer)->type == PACKET_AXES_TARGET_SET) {
+        addr[0] = BROADCAST_ADDRESS_BYTE;
+        Mirf.configRegister(EN_AA, 0);
+    } else {
+        addr[0] += RADIO_KNOB_AXIS;
+        Mirf.configRegister(EN_AA, 1 << ENAA_P0);
+    }
+    Mirf.setTADDR(addr);
     Mirf.send((uint8_t *)buffer);
     while (Mirf.isSending()) {
     }
@@ -43,16 +54,19 @@ void _send_radio_packet(void *buffer)
     sprintf(__buffer, "%c=%s",\
             serial_cmd,\
             packet.name.val);\
-    serial_api_queue_output(__buffer);\
+    serial_api_queue_reply(serial_cmd, __buffer);\
 } while(0)
 
 void radio_queue_message(radio_packet_t packet)
 {
     // packet.version = RADIO_VERSION;
-    radio_state.buffer[radio_state.write_index++] = packet;
-    radio_state.write_index %= RADIO_OUT_BUFFER_SIZE;
-
-    // BSP_assert(radio_state.write_index != radio_state.read_index);
+    int next = (radio_state.write_index + 1) % RADIO_OUT_BUFFER_SIZE;
+    if (next == radio_state.read_index) {
+        // full: drop this one rather than wrap over everything queued
+        return;
+    }
+    radio_state.buffer[radio_state.write_index] = packet;
+    radio_state.write_index = next;
 }
 
 void radio_init()
@@ -64,6 +78,10 @@ void radio_init()
 
     int channel = settings_get_channel();
     radio_set_channel(channel, true);
+
+    for (int i = 0; i < RADIO_AXES; ++i) {
+        radio_state.axis_targets[i] = AXIS_TARGET_HOLD;
+    }
 }
 
 void radio_run()
@@ -102,6 +120,39 @@ bool radio_is_alive()
 {
     uint8_t addr[mirf_ADDR_LEN];
 
+    // every address we send to differs from TRANSMIT_ADDRESS in the first
+    // byte only
     Mirf.readRegister(TX_ADDR, addr, mirf_ADDR_LEN);
-    return memcmp(addr, (uint8_t *)TRANSMIT_ADDRESS, mirf_ADDR_LEN) == 0;
+    return memcmp(addr + 1, (uint8_t *)TRANSMIT_ADDRESS + 1,
+                  mirf_ADDR_LEN - 1) == 0;
+}
+
+bool radio_busy()
+{
+    return radio_state.read_index != radio_state.write_index;
+}
+
+void radio_set_axis_target(int axis, long position)
+{
+    // past int16 is clamped short of AXIS_TARGET_HOLD
+    if (position != AXIS_TARGET_HOLD) {
+        position = position < -32767 ? -32767 :
+                   position > 32767 ? 32767 : position;
+    }
+    radio_state.axis_targets[axis] = (int)position;
+}
+
+int radio_get_axis_target(int axis)
+{
+    return radio_state.axis_targets[axis];
+}
+
+void radio_send_axis_targets()
+{
+    radio_packet_t packet = {0};
+    packet.axes_target_set.type = PACKET_AXES_TARGET_SET;
+    for (int i = 0; i < RADIO_AXES; ++i) {
+        packet.axes_target_set.targets[i] = radio_state.axis_targets[i];
+    }
+    radio_queue_message(packet);
 }
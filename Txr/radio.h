@@ -3,14 +3,21 @@
 
 #include "serial_api.h"
 
-#define RADIO_OUT_BUFFER_SIZE       64
-#define STRING_PACKET_BUFFER_SIZE   60
-#define RADIO_VERSION               01
+// a handful of packets go out per event at most; see the RAM budget in Txr.h
+#define RADIO_OUT_BUFFER_SIZE       16
+// see Rxr/radio.h
+#define RADIO_VERSION               02
 
 #define RF_DEFAULT                  0b00100011  // 250kbps 0dB
 #define TRANSMIT_ADDRESS            "serv1"
 #define RECEIVE_ADDRESS             "clie1"
 
+// how the axes are addressed, see Rxr/radio.h
+#define RADIO_AXES                  3   // focus, iris, zoom
+#define RADIO_KNOB_AXIS             0   // the one the pot and encoder drive
+#define BROADCAST_ADDRESS_BYTE      'b'
+#define AXIS_TARGET_HOLD            (-32767 - 1)
+
 
 enum {
     PACKET_NONE                     = 0,
@@ -49,6 +56,8 @@ enum {
     PACKET_START_STATE_SET          = 33,
     PACKET_START_STATE_PRINT        = 34,
     PACKET_RE_INIT_POSITION         = 35,
+    PACKET_TIMED_MOVE_SET           = 36,
+    PACKET_AXES_TARGET_SET          = 37,
     PACKET_OK                       = 120,
 };
 
@@ -89,6 +98,19 @@ struct u32_packet_t {
     long val;
 };
 
+// see Rxr/radio.h
+struct timed_move_packet_t {
+    char type;
+    int position;               // steps
+    unsigned int duration;      // ms
+};
+
+// see Rxr/radio.h
+struct axes_target_packet_t {
+    char type;
+    int targets[RADIO_AXES];    // steps
+};
+
 struct radio_packet_t {
     union {
         char type;
@@ -124,6 +146,8 @@ struct radio_packet_t {
         i16_packet_t start_state_set;
         i16_packet_t start_state_print;
         empty_packet_t re_init_position;
+        timed_move_packet_t timed_move_set;
+        axes_target_packet_t axes_target_set;
         ok_packet_t ok;
     };
 };
@@ -134,12 +158,10 @@ struct radio_state_t {
     radio_packet_t buffer[RADIO_OUT_BUFFER_SIZE];
     int write_index;
     int read_index;
-    char string_packet_command;
-    char string_packet_buffer[STRING_PACKET_BUFFER_SIZE];
-    int string_packet_buffer_index;
     int version_match;
     long heartbeat_sent_timestamp;
     long heartbeat_received_timestamp;
+    int axis_targets[RADIO_AXES];
 };
 
 #define PACKET_SEND_EMPTY(packet_type) do {\
@@ -167,5 +189,14 @@ void radio_run();
 void radio_queue_message(radio_packet_t packet);
 void radio_set_channel(int channel, bool force);
 bool radio_is_alive();
+// True while packets are queued behind the one on the air.
+bool radio_busy();
+
+// The targets the next PACKET_AXES_TARGET_SET carries, in steps. All start
+// out at AXIS_TARGET_HOLD.
+void radio_set_axis_target(int axis, long position);
+int radio_get_axis_target(int axis);
+// Queues one frame with every axis's target.
+void radio_send_axis_targets();
 
 #endif //radio_h
@@ -5,12 +5,16 @@
 #include "settings.h"
 #include "eeprom_helpers.h"
 #include "leds.h"
+#include "pot_filter.h"
+#include "take.h"
 #include "Arduino.h"
 
 const char SERIAL_API_END_OF_RESPONSE       = '\n';
 const char SERIAL_API_END_OF_COMMAND        = '\n';
 const char SERIAL_API_ESCAPE                = '\\';
+const char SERIAL_API_REQUEST_ID            = '#';
 const int SERIAL_API_EEPROM_SCAN_LENGTH     = 16;
+const int SERIAL_API_LOG_LINE_LENGTH        = 16;
 
 const char* MAX_RESPONSE_LENGTH_EXCEEDED    = "ERR 01";
 const char* MAX_INPUT_LENGTH_EXCEEDED       = "ERR 02";
@@ -31,15 +35,13 @@ inline char *_serial_api_in(int index)
 
 inline void _serial_api_print(const char *in)
 {
-    char *out = _serial_api_out(serial_api_state.out_index);
-
     while (*in) {
-        if (serial_api_state.out_index++ > SERIAL_API_OUT_BUFFER_SIZE) {
+        // a response that doesn't fit is replaced by the error
+        if (serial_api_state.out_index >= SERIAL_API_OUT_BUFFER_SIZE) {
             serial_api_state.out_index = 0;
-            out = _serial_api_out(0);
-            in = (char *)MAX_RESPONSE_LENGTH_EXCEEDED;
+            in = MAX_RESPONSE_LENGTH_EXCEEDED;
         }
-        *(out++) = *(in++);
+        *_serial_api_out(serial_api_state.out_index++) = *(in++);
     }
 }
 
@@ -58,8 +60,19 @@ inline void _serial_api_print_len(char *in, int len)
     }
 }
 
+inline void _serial_api_print_request_id()
+{
+    if (serial_api_state.request_id) {
+        char buffer[8];
+        sprintf(buffer, "%c%u ", SERIAL_API_REQUEST_ID,
+                serial_api_state.request_id);
+        _serial_api_print(buffer);
+    }
+}
+
 inline void _serial_api_end(const char *in)
 {
+    _serial_api_print_request_id();
     _serial_api_print(in);
     _serial_api_print("\n");
 }
@@ -73,6 +86,7 @@ inline void _serial_api_print_ok(char type)
 
 inline void _serial_api_end_len(char *in, int len)
 {
+    _serial_api_print_request_id();
     _serial_api_print_len(in, len);
     _serial_api_print("\n");
 }
@@ -82,35 +96,113 @@ inline void _serial_api_reset_in_buffer()
     serial_api_state.in_index = 0;
 }
 
+// Parses an optional "#<id> " prefix, returning the offset of the command
+// proper, or -1 if the prefix is malformed. Ids run from 1 to 65535; zero
+// means the command carried no id.
+int _serial_api_parse_request_id(char *in, int length)
+{
+    if (*in != SERIAL_API_REQUEST_ID) {
+        return 0;
+    }
+
+    unsigned long id = 0;
+    int i = 1;
+    while (i < length && in[i] >= '0' && in[i] <= '9' && id <= 0xffff) {
+        id = id * 10 + (in[i++] - '0');
+    }
+
+    if (i == 1 || i >= length || in[i] != ' ' || !id || id > 0xffff) {
+        return -1;
+    }
+
+    serial_api_state.request_id = (unsigned int)id;
+    return i + 1;
+}
+
+unsigned int _serial_api_take_pending(char key)
+{
+    unsigned long now = millis();
+    for (int i = 0; i < SERIAL_API_PENDING_SIZE; ++i) {
+        // start at the oldest slot so replies of the same key come back FIFO
+        int index = (serial_api_state.pending_index + i) %
+            SERIAL_API_PENDING_SIZE;
+        serial_api_pending_t *pending = &serial_api_state.pending[index];
+
+        // a reply that never came mustn't lend its id to a later line
+        if (pending->key &&
+            now - pending->millis > SERIAL_API_PENDING_TIMEOUT_MS) {
+            pending->key = 0;
+        }
+        if (pending->key == key) {
+            pending->key = 0;
+            return pending->request_id;
+        }
+    }
+    return 0;
+}
+
+int _serial_api_log_slot(char key, long value)
+{
+    switch (key) {
+    case (SERIAL_POT_GET): return SERIAL_LOG_POT;
+    case (SERIAL_ENCODER_GET): return SERIAL_LOG_ENCODER;
+    case (SERIAL_MAX_SPEED_GET): return SERIAL_LOG_MAX_SPEED;
+    case (SERIAL_ACCEL_GET): return SERIAL_LOG_ACCEL;
+    case (SERIAL_PRESET_INDEX_GET): return SERIAL_LOG_PRESET_INDEX;
+    case (SERIAL_LEDS): {
+        return SERIAL_LOG_LEDS + (value & (SERIAL_API_LOG_LED_SLOTS - 1));
+    }
+    }
+    return -1;
+}
+
+char _serial_api_log_key(int slot)
+{
+    switch (slot) {
+    case (SERIAL_LOG_POT): return SERIAL_POT_GET;
+    case (SERIAL_LOG_ENCODER): return SERIAL_ENCODER_GET;
+    case (SERIAL_LOG_MAX_SPEED): return SERIAL_MAX_SPEED_GET;
+    case (SERIAL_LOG_ACCEL): return SERIAL_ACCEL_GET;
+    case (SERIAL_LOG_PRESET_INDEX): return SERIAL_PRESET_INDEX_GET;
+    }
+    return SERIAL_LEDS;
+}
+
+// the parsers truncate like AVR int and long would, so the host
+// builds see the same values as the units
 int _parse_i16(char* in) {
-    int val;
-    sscanf(in + 2, "%d", &val);
-    return val;
+    long val = 0;
+    sscanf(in + 2, "%ld", &val);
+    return (int16_t)val;
 }
 
 long _parse_i32(char* in) {
-    long val;
+    long val = 0;
     sscanf(in + 2, "%ld", &val);
-    return val;
+    return (int32_t)val;
 }
 
 unsigned int _parse_u16(char* in) {
-    unsigned int val;
-    sscanf(in + 2, "%u", &val);
-    return val;
+    unsigned long val = 0;
+    sscanf(in + 2, "%lu", &val);
+    return (uint16_t)val;
 }
 
 unsigned long _parse_u32(char* in) {
-    unsigned long val;
+    unsigned long val = 0;
     sscanf(in + 2, "%lu", &val);
-    return val;
+    return (uint32_t)val;
 }
 
 void _print_string(char type, char* str)
 {
-    char buffer[60];
-    sprintf(buffer, "%c=%s", type, str);
-    _serial_api_end(buffer);
+    // printed in pieces, names and the debug string don't fit
+    // a small stack buffer
+    char key[3] = { type, '=', 0 };
+    _serial_api_print_request_id();
+    _serial_api_print(key);
+    _serial_api_print(str);
+    _serial_api_print("\n");
 }
 
 void _print_i16(char type, int val)
@@ -141,9 +233,8 @@ void _print_u32(char type, unsigned long val)
     _serial_api_end(buffer);
 }
 
-void _serial_api_process_command(int length)
+void _serial_api_process_command(char *in, int length)
 {
-    char *in = _serial_api_in(0);
     char cmd = *in;
 
     switch (cmd) {
@@ -163,9 +254,11 @@ void _serial_api_process_command(int length)
         _print_i16(cmd, ROLE);
     } break;
     case (SERIAL_REMOTE_VERSION): {
+        serial_api_expect_reply(cmd);
         PACKET_SEND_EMPTY(PACKET_VERSION_GET);
     } break;
     case (SERIAL_REMOTE_ROLE): {
+        serial_api_expect_reply(cmd);
         PACKET_SEND_EMPTY(PACKET_ROLE_GET);
     } break;
     case (SERIAL_PRESET_INDEX_GET): {
@@ -173,11 +266,15 @@ void _serial_api_process_command(int length)
     } break;
     case (SERIAL_PRESET_INDEX_SET): {
         int index = _parse_i16(in);
+        if (index < 0 || index >= MAX_PROFILES) {
+            _serial_api_end(MALFORMED_COMMAND);
+            break;
+        }
         int old_index = settings_get_preset_index();
         if (index != old_index) {
             settings_set_preset_index(index);
         }
-        _serial_api_print_ok(cmd);   
+        _serial_api_print_ok(cmd);
     } break;
     case (SERIAL_ID_GET): {
         _print_u32(cmd, settings_get_id());
@@ -187,7 +284,7 @@ void _serial_api_process_command(int length)
         _serial_api_print_ok(cmd);
     } break;
     case (SERIAL_NAME_GET): {
-        char buffer[NAME_MAX_LENGTH];
+        char buffer[NAME_SIZE];
         settings_get_name(buffer);
         _print_string(cmd, buffer);
     } break;
@@ -205,6 +302,7 @@ void _serial_api_process_command(int length)
         _serial_api_print_ok(cmd);
     } break;
     case (SERIAL_REMOTE_CHANNEL_GET): {
+        serial_api_expect_reply(cmd);
         PACKET_SEND_EMPTY(PACKET_CHANNEL_GET);
     } break;
     case (SERIAL_START_STATE_GET): {
@@ -249,6 +347,7 @@ void _serial_api_process_command(int length)
         _serial_api_print_ok(cmd);
     } break;
     case (SERIAL_TARGET_POSITION_GET): {
+        serial_api_expect_reply(cmd);
         PACKET_SEND_EMPTY(PACKET_TARGET_POSITION_GET);
     } break;
     case (SERIAL_TARGET_POSITION_SET): {
@@ -258,8 +357,12 @@ void _serial_api_process_command(int length)
     } break;
     case (SERIAL_EEPROM_EXPORT): {
         int start = _parse_i16(in);
+        if (start < EEPROM_MIN_ADDR || start > EEPROM_MAX_ADDR) {
+            _serial_api_end(MALFORMED_COMMAND);
+            break;
+        }
+        settings_compact();
         int length = min(EEPROM_MAX_ADDR - start, SERIAL_API_EEPROM_SCAN_LENGTH);
-        length = max(0, length);
         unsigned char byte_buffer[SERIAL_API_EEPROM_SCAN_LENGTH];
         eeprom_read_bytes(start, byte_buffer, length);
 
@@ -273,19 +376,25 @@ void _serial_api_process_command(int length)
     } break;
     case (SERIAL_EEPROM_IMPORT): {
         int start = _parse_i16(in);
-        int length;
-        char buffer[33];
+        int length = 0;
+        char buffer[33] = {0};
         sscanf(in, "%*c %*d %d %32s", &length, buffer);
-        if (length > 16) {
+        if (length > 16 || (length > 0 && length * 2 > (int)strlen(buffer)) ||
+            start < EEPROM_MIN_ADDR || start + length > EEPROM_MAX_ADDR) {
             _serial_api_end(MALFORMED_COMMAND);
         } else if (length > 0) {
             unsigned char byte_buffer[17];
             for (int i = 0; i < length; ++i) {
-                unsigned char byte;
+                unsigned char byte = 0;
                 sscanf(buffer + i * 2, "%02hhx", &byte);
                 byte_buffer[i] = byte;
             }
+            settings_compact();
             eeprom_write_bytes(start, byte_buffer, length);
+            // the import may have rewritten settings behind their RAM copy
+            // and their checksums
+            settings_update_checksums();
+            settings_reload();
 
             _serial_api_print_ok(cmd);
         } else {
@@ -304,6 +413,163 @@ void _serial_api_process_command(int length)
         settings_reset_to_defaults();
         _serial_api_print_ok(cmd);
     } break;
+    case (SERIAL_EEPROM_STATS): {
+        // "k" for the totals, "k <block>" for one 64 byte block
+        int block = 0;
+        if (sscanf(in + 1, "%d", &block) == 1) {
+            if (block < 0 || block >= EEPROM_STATS_BLOCKS) {
+                _serial_api_end(MALFORMED_COMMAND);
+                break;
+            }
+            _print_u32(cmd, eeprom_stats.block_writes[block]);
+        } else {
+            char buffer[36];
+            sprintf(buffer, "%lu %lu %lu",
+                eeprom_stats.written, eeprom_stats.skipped,
+                eeprom_stats.wait_us);
+            _print_string(cmd, buffer);
+        }
+    } break;
+    case (SERIAL_EEPROM_STATS_RESET): {
+        eeprom_reset_stats();
+        _serial_api_print_ok(cmd);
+    } break;
+    case (SERIAL_POT_FILTER_GET): {
+        // "<min alpha> <beta> <dead band>", see pot_filter.h
+        pot_filter_params_t params = pot_filter_get_params();
+        char buffer[24];
+        sprintf(buffer, "%d %d %d",
+            params.min_alpha, params.beta, params.dead_band);
+        _print_string(cmd, buffer);
+    } break;
+    case (SERIAL_POT_FILTER_SET): {
+        pot_filter_params_t params;
+        if (sscanf(in + 2, "%d %d %d", &params.min_alpha, &params.beta,
+                   &params.dead_band) != 3 ||
+            !pot_filter_set_params(params)) {
+            _serial_api_end(MALFORMED_COMMAND);
+            break;
+        }
+        _serial_api_print_ok(cmd);
+    } break;
+    case (SERIAL_IDLE_GET): {
+        // time asleep since the last "z", in 1/1000ths
+        _print_u16(cmd, BSP_idle_permille());
+    } break;
+    case (SERIAL_QF_USAGE_GET): {
+        // "<queue len> <queue min free> <pool len> <pool min free>"
+        bsp_qf_usage_t usage;
+        BSP_get_qf_usage(&usage);
+        char buffer[24];
+        sprintf(buffer, "%d %d %d %d", usage.queue_len, usage.queue_min_free,
+            usage.pool_len, usage.pool_min_free);
+        _print_string(cmd, buffer);
+    } break;
+    case (SERIAL_TAKE_GET): {
+        // "<mode> <samples> <bytes> <buffer bytes>", see take.h
+        char buffer[28];
+        sprintf(buffer, "%d %d %d %d", take_mode(), take_samples(),
+            take_length(), TAKE_BUFFER_SIZE);
+        _print_string(cmd, buffer);
+    } break;
+    case (SERIAL_TAKE_SET): {
+        // "R 0" stop, "R 1" record, "R 2" cue, "R 3" play; a replay only
+        // drives the motor in play-back mode
+        bool ok = true;
+        switch (_parse_i16(in)) {
+        case (TAKE_IDLE): {
+            take_stop();
+        } break;
+        case (TAKE_RECORDING): {
+            take_record();
+        } break;
+        case (TAKE_CUED): {
+            ok = BSP_get_mode() == PLAY_BACK_MODE && take_cue();
+        } break;
+        case (TAKE_PLAYING): {
+            ok = BSP_get_mode() == PLAY_BACK_MODE && take_play();
+        } break;
+        default: {
+            ok = false;
+        } break;
+        }
+        if (ok) {
+            _serial_api_print_ok(cmd);
+        } else {
+            _serial_api_end(MALFORMED_COMMAND);
+        }
+    } break;
+    case (SERIAL_TAKE_EXPORT): {
+        // the take image like 'g' does the EEPROM, 16 bytes at a time
+        int start = _parse_i16(in);
+        if (start < 0 || start >= TAKE_IMAGE_SIZE) {
+            _serial_api_end(MALFORMED_COMMAND);
+            break;
+        }
+        int length = min(TAKE_IMAGE_SIZE - start, SERIAL_API_EEPROM_SCAN_LENGTH);
+        unsigned char byte_buffer[SERIAL_API_EEPROM_SCAN_LENGTH];
+        take_read_image(start, byte_buffer, length);
+
+        char buffer[SERIAL_API_EEPROM_SCAN_LENGTH * 2 + 1];
+        buffer[0] = 0;
+        for (int i = 0; i < length; ++i) {
+            sprintf(buffer + (i * 2), "%02x", byte_buffer[i]);
+        }
+        _print_string(cmd, buffer);
+    } break;
+    case (SERIAL_TAKE_IMPORT): {
+        int start = _parse_i16(in);
+        int length = 0;
+        char buffer[33] = {0};
+        sscanf(in, "%*c %*d %d %32s", &length, buffer);
+        if (length < 0 || length > 16 ||
+            length * 2 > (int)strlen(buffer) ||
+            start < 0 || start + length > TAKE_IMAGE_SIZE) {
+            _serial_api_end(MALFORMED_COMMAND);
+            break;
+        }
+        unsigned char byte_buffer[16];
+        for (int i = 0; i < length; ++i) {
+            unsigned char byte = 0;
+            sscanf(buffer + i * 2, "%02hhx", &byte);
+            byte_buffer[i] = byte;
+        }
+        take_write_image(start, byte_buffer, length);
+        _serial_api_print_ok(cmd);
+    } break;
+    case (SERIAL_MOVE_TIME): {
+        // "P <position>" for how long the move to a saved position takes,
+        // in ms, "P <position> <ms>" to set it; 0 is untimed
+        int index = -1;
+        unsigned int duration = 0;
+        int count = sscanf(in + 1, "%d %u", &index, &duration);
+        if (count < 1 || index < 0 || index >= NUM_SAVED_POSITIONS) {
+            _serial_api_end(MALFORMED_COMMAND);
+        } else if (count == 1) {
+            _print_u16(cmd, settings_get_saved_duration(index));
+        } else {
+            settings_set_saved_duration(index, (uint16_t)duration);
+            _serial_api_print_ok(cmd);
+        }
+    } break;
+    case (SERIAL_AXIS_TARGET): {
+        // "W <axis>" for where an axis is being sent, "W <axis> <steps>" to
+        // send it somewhere else, -32768 to leave it where it is. The knob's
+        // own axis follows the pot.
+        int axis = -1;
+        long position = 0;
+        int count = sscanf(in + 1, "%d %ld", &axis, &position);
+        if (count < 1 || axis < 0 || axis >= RADIO_AXES ||
+            (count > 1 && axis == RADIO_KNOB_AXIS)) {
+            _serial_api_end(MALFORMED_COMMAND);
+        } else if (count == 1) {
+            _print_i16(cmd, radio_get_axis_target(axis));
+        } else {
+            radio_set_axis_target(axis, position);
+            radio_send_axis_targets();
+            _serial_api_print_ok(cmd);
+        }
+    } break;
     default: {
         _serial_api_end(UNKNOWN_COMMAND);
     } break;
@@ -317,8 +583,19 @@ void _serial_api_inner_queue_byte(char byte,
 
     if (byte == SERIAL_API_END_OF_COMMAND) {
         *next = 0;
-        int len = index;
-        _serial_api_process_command(len);
+        // a bare "X" still gets an empty argument at in + 2
+        if (index + 1 < SERIAL_API_IN_BUFFER_SIZE) {
+            *(next + 1) = 0;
+        }
+        char *in = _serial_api_in(0);
+        int offset = _serial_api_parse_request_id(in, index);
+
+        if (offset < 0) {
+            _serial_api_end(MALFORMED_COMMAND);
+        } else {
+            _serial_api_process_command(in + offset, index - offset);
+        }
+        serial_api_state.request_id = 0;
         _serial_api_reset_in_buffer();
     } else {
         *next = byte;
@@ -338,11 +615,11 @@ serial_api_response_t serial_api_read_response()
 
 void serial_api_queue_byte(char byte)
 {
-    int i = serial_api_state.in_index++;
-
-    if (i < SERIAL_API_IN_BUFFER_SIZE) {
-        _serial_api_inner_queue_byte(byte, i);
-    } else {
+    if (serial_api_state.in_index < SERIAL_API_IN_BUFFER_SIZE) {
+        _serial_api_inner_queue_byte(byte, serial_api_state.in_index++);
+    } else if (byte == SERIAL_API_END_OF_COMMAND) {
+        // swallow the rest of an overlong command rather than
+        // running its tail as a command of its own
         _serial_api_end(MAX_INPUT_LENGTH_EXCEEDED);
         _serial_api_reset_in_buffer();
     }
@@ -358,3 +635,65 @@ void serial_api_queue_output_len(char *message,
 {
     _serial_api_end_len(message, length);
 }
+
+void serial_api_expect_reply(char key)
+{
+    if (serial_api_state.request_id) {
+        serial_api_pending_t *pending =
+            &serial_api_state.pending[serial_api_state.pending_index++];
+        serial_api_state.pending_index %= SERIAL_API_PENDING_SIZE;
+
+        pending->key = key;
+        pending->request_id = serial_api_state.request_id;
+        pending->millis = millis();
+    }
+}
+
+void serial_api_queue_reply(char key, const char *message)
+{
+    unsigned int request_id = serial_api_state.request_id;
+
+    serial_api_state.request_id = _serial_api_take_pending(key);
+    _serial_api_end(message);
+    serial_api_state.request_id = request_id;
+}
+
+void serial_api_flush_log()
+{
+    serial_api_log_t *log = &serial_api_state.log;
+
+    for (int slot = 0; log->dirty && slot < SERIAL_LOG_SLOTS; ++slot) {
+        unsigned long bit = 1UL << slot;
+        if (!(log->dirty & bit)) {
+            continue;
+        }
+
+        // whatever doesn't fit stays dirty for the next pass
+        if (serial_api_state.out_index + SERIAL_API_LOG_LINE_LENGTH >
+            SERIAL_API_OUT_BUFFER_SIZE) {
+            break;
+        }
+
+        char buffer[SERIAL_API_LOG_LINE_LENGTH];
+        sprintf(buffer, "%c=%ld", _serial_api_log_key(slot), log->values[slot]);
+        _serial_api_print(buffer);
+        _serial_api_print("\n");
+
+        log->dirty &= ~bit;
+    }
+}
+
+void log_value(char key, long value)
+{
+    int slot = _serial_api_log_slot(key, value);
+
+    if (slot < 0) {
+        char buffer[SERIAL_API_LOG_LINE_LENGTH];
+        sprintf(buffer, "%c=%ld", key, value);
+        _serial_api_print(buffer);
+        _serial_api_print("\n");
+    } else {
+        serial_api_state.log.values[slot] = value;
+        serial_api_state.log.dirty |= 1UL << slot;
+    }
+}
@@ -5,12 +5,44 @@
 
 const int SERIAL_API_IN_BUFFER_SIZE         = 128;
 const int SERIAL_API_OUT_BUFFER_SIZE        = 128;
+const int SERIAL_API_PENDING_SIZE           = 8;
+const unsigned long SERIAL_API_PENDING_TIMEOUT_MS = 1000;
+const int SERIAL_API_LOG_LED_SLOTS          = 16;
+
+// a remote command's reply waits here for its request id, see Rxr/serial_api.h
+struct serial_api_pending_t {
+    char key;
+    unsigned int request_id;
+    unsigned long millis;       // when it was asked
+};
+
+// log_value() only records the latest value per key and marks it
+// dirty; console_run() formats whatever is dirty once per pass. Each LED gets
+// its own slot so one LED changing doesn't hide another.
+enum {
+    SERIAL_LOG_POT,
+    SERIAL_LOG_ENCODER,
+    SERIAL_LOG_MAX_SPEED,
+    SERIAL_LOG_ACCEL,
+    SERIAL_LOG_PRESET_INDEX,
+    SERIAL_LOG_LEDS,
+    SERIAL_LOG_SLOTS = SERIAL_LOG_LEDS + SERIAL_API_LOG_LED_SLOTS
+};
+
+struct serial_api_log_t {
+    long values[SERIAL_LOG_SLOTS];
+    unsigned long dirty;
+};
 
 struct serial_api_state_t {
     char in_buffer[SERIAL_API_IN_BUFFER_SIZE];
     char out_buffer[SERIAL_API_OUT_BUFFER_SIZE];
     int in_index;
     int out_index;
+    unsigned int request_id;
+    serial_api_pending_t pending[SERIAL_API_PENDING_SIZE];
+    int pending_index;
+    serial_api_log_t log;
 };
 
 enum {
@@ -47,6 +79,18 @@ enum {
     SERIAL_DEBUG_FAIL_ASSERT    = 'B',
     SERIAL_DEBUG_STRING_GET     = 'b',
     SERIAL_FACTORY_RESET        = 'Y',
+    SERIAL_EEPROM_STATS         = 'k',
+    SERIAL_EEPROM_STATS_RESET   = 'K',
+    SERIAL_POT_FILTER_GET       = 'f',
+    SERIAL_POT_FILTER_SET       = 'F',
+    SERIAL_IDLE_GET             = 'z',
+    SERIAL_QF_USAGE_GET         = 'j',
+    SERIAL_TAKE_GET             = 'y',
+    SERIAL_TAKE_SET             = 'R',
+    SERIAL_TAKE_EXPORT          = 'E',
+    SERIAL_TAKE_IMPORT          = 'L',
+    SERIAL_MOVE_TIME            = 'P',
+    SERIAL_AXIS_TARGET          = 'W',
     SERIAL_IGNORE               = '_',
 };
 
@@ -73,13 +117,9 @@ void serial_api_queue_byte(char byte);
 void serial_api_queue_output(const char *message);
 void serial_api_queue_output_len(char *message,
                                  int length);
-
-inline void log_value(char key, long value)
-{
-    char buffer[32];
-    sprintf(buffer, "%c=%ld", key, value);
-
-    serial_api_queue_output(buffer);
-}
+void serial_api_expect_reply(char key);
+void serial_api_queue_reply(char key, const char *message);
+void serial_api_flush_log();
+void log_value(char key, long value);
 
 #endif
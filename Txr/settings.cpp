@@ -1,8 +1,13 @@
 #include "Arduino.h"
 #include "settings.h"
+#include "settings_log.h"
 
 static settings_state_t settings_state;
 
+// regions written by the compaction in progress: bit 0 the globals, bit
+// 1 + n profile n
+static unsigned int settings_compacted_regions;
+
 int _settings_position(int preset, int offset, int size)
 {
     // 2*0+0*9 2*0+1*9 2*9+0*11  2*9+1*11
@@ -12,14 +17,11 @@ int _settings_position(int preset, int offset, int size)
 
 int _settings_position(int offset, int size)
 {
-    int preset = settings_get_preset_index();
-    return _settings_position(preset, offset, size);
+    return _settings_position(settings_state.preset_index, offset, size);
 }
 
-
-char settings_get_preset_index()
+char _settings_clamp_preset_index(char preset_index)
 {
-    char preset_index = eeprom_read_char(PRESET_INDEX_OFFSET);
     if (preset_index < 0) {
         return 0;
     } else if (preset_index > 3) {
@@ -29,118 +31,452 @@ char settings_get_preset_index()
     }
 }
 
+int _settings_home_position(char key)
+{
+    if (key >= SETTINGS_LOG_MAX_ACCEL) {
+        return _settings_position(key - SETTINGS_LOG_MAX_ACCEL,
+            MAX_ACCEL_OFFSET, MAX_ACCEL_SIZE);
+    } else if (key >= SETTINGS_LOG_MAX_SPEED) {
+        return _settings_position(key - SETTINGS_LOG_MAX_SPEED,
+            MAX_SPEED_OFFSET, MAX_SPEED_SIZE);
+    } else if (key >= SETTINGS_LOG_SAVED_POSITION) {
+        return SAVED_POSITION_OFFSET +
+            (key - SETTINGS_LOG_SAVED_POSITION) * sizeof(int16_t);
+    }
+
+    switch (key) {
+    case (SETTINGS_LOG_PRESET_INDEX): return PRESET_INDEX_OFFSET;
+    case (SETTINGS_LOG_CHANNEL): return CHANNEL_OFFSET;
+    case (SETTINGS_LOG_CAL_POS_1): return CAL_POS_1_OFFSET;
+    case (SETTINGS_LOG_CAL_POS_2): return CAL_POS_2_OFFSET;
+    case (SETTINGS_LOG_START_IN_CAL): return START_IN_CAL_OFFSET;
+    }
+    return -1;
+}
+
+unsigned int _settings_globals_crc()
+{
+    return eeprom_crc16(GLOBALS_START, GLOBALS_END - GLOBALS_START,
+        EEPROM_CRC16_INIT);
+}
+
+int _settings_saved_duration_position(int index)
+{
+    return SAVED_DURATION_OFFSET + index * sizeof(uint16_t);
+}
+
+int _settings_calibration_point_position(int index)
+{
+    return CAL_POINTS_OFFSET + index * 2 * sizeof(int16_t);
+}
+
+unsigned int _settings_profile_crc(int preset)
+{
+    unsigned int crc = EEPROM_CRC16_INIT;
+    crc = eeprom_crc16(_settings_position(preset, ID_OFFSET, ID_SIZE),
+        ID_SIZE, crc);
+    crc = eeprom_crc16(_settings_position(preset, MAX_SPEED_OFFSET, MAX_SPEED_SIZE),
+        MAX_SPEED_SIZE, crc);
+    crc = eeprom_crc16(_settings_position(preset, MAX_ACCEL_OFFSET, MAX_ACCEL_SIZE),
+        MAX_ACCEL_SIZE, crc);
+    crc = eeprom_crc16(_settings_position(preset, NAME_OFFSET, NAME_SIZE),
+        NAME_SIZE, crc);
+    return crc;
+}
+
+int _settings_profile_crc_position(int preset)
+{
+    return PROFILE_CRC_LOC + preset * sizeof(uint16_t);
+}
+
+void _settings_seal_globals()
+{
+    eeprom_write_uint16(GLOBALS_CRC_LOC, _settings_globals_crc());
+}
+
+void _settings_seal_profile(int preset)
+{
+    eeprom_write_uint16(_settings_profile_crc_position(preset),
+        _settings_profile_crc(preset));
+}
+
+bool _settings_globals_valid()
+{
+    return eeprom_read_uint16(GLOBALS_CRC_LOC) == _settings_globals_crc();
+}
+
+bool _settings_profile_valid(int preset)
+{
+    return eeprom_read_uint16(_settings_profile_crc_position(preset)) ==
+           _settings_profile_crc(preset);
+}
+
+void _settings_default_globals()
+{
+    eeprom_write_int16(CAL_POS_1_OFFSET, DEFAULT_CAL_POS_1);
+    eeprom_write_int16(CAL_POS_2_OFFSET, DEFAULT_CAL_POS_2);
+
+    for (int i = 0; i < NUM_SAVED_POSITIONS; ++i) {
+        eeprom_write_int16(SAVED_POSITION_OFFSET + (i * sizeof(int16_t)),
+            DEFAULT_SAVED_POSITION);
+        eeprom_write_uint16(_settings_saved_duration_position(i),
+            DEFAULT_SAVED_DURATION);
+    }
+    eeprom_write_int16(START_IN_CAL_OFFSET, DEFAULT_START_IN_CAL);
+
+    eeprom_write_int16(CHANNEL_OFFSET, DEFAULT_CHANNEL);
+
+    eeprom_write_int16(CAL_POINT_COUNT_OFFSET, 0);
+
+    eeprom_write_char(PRESET_INDEX_OFFSET, 0);
+
+    _settings_seal_globals();
+}
+
+void _settings_default_profile(int preset)
+{
+    eeprom_write_uint16(
+        _settings_position(preset, MAX_SPEED_OFFSET, MAX_SPEED_SIZE),
+        DEFAULT_MAX_SPEED);
+    eeprom_write_int16(
+        _settings_position(preset, MAX_ACCEL_OFFSET, MAX_ACCEL_SIZE),
+        DEFAULT_MAX_ACCEL * 4);
+    eeprom_write_uint32(
+        _settings_position(preset, ID_OFFSET, ID_SIZE),
+        DEFAULT_ID_SEED + (long)preset);
+    eeprom_write_string(
+        _settings_position(preset, NAME_OFFSET, NAME_SIZE),
+        DEFAULT_NAME, NAME_MAX_LENGTH);
+
+    _settings_seal_profile(preset);
+}
+
+// version 0 had no checksums; what's there is all we have
+void _settings_migrate_0_to_1()
+{
+    settings_update_checksums();
+}
+
+// version 1 ended the globals at the channel; the saved durations start
+// out untimed, and the CRC then has to cover them. A unit coming up from
+// version 0 was sealed over the new range already. Globals that were torn
+// are left for settings_init() to default.
+void _settings_migrate_1_to_2()
+{
+    unsigned int crc = eeprom_crc16(GLOBALS_START,
+        GLOBALS_END_V1 - GLOBALS_START, EEPROM_CRC16_INIT);
+    if (eeprom_read_uint16(GLOBALS_CRC_LOC) != crc &&
+        !_settings_globals_valid()) {
+        return;
+    }
+    for (int i = 0; i < NUM_SAVED_POSITIONS; ++i) {
+        eeprom_write_uint16(_settings_saved_duration_position(i),
+            DEFAULT_SAVED_DURATION);
+    }
+    _settings_seal_globals();
+}
+
+// version 2 ended the globals at the saved durations; calibrations from
+// before are two points, the ends, with none in between
+void _settings_migrate_2_to_3()
+{
+    unsigned int crc = eeprom_crc16(GLOBALS_START,
+        GLOBALS_END_V2 - GLOBALS_START, EEPROM_CRC16_INIT);
+    if (eeprom_read_uint16(GLOBALS_CRC_LOC) != crc &&
+        !_settings_globals_valid()) {
+        return;
+    }
+    eeprom_write_int16(CAL_POINT_COUNT_OFFSET, 0);
+    _settings_seal_globals();
+}
+
+typedef void (*settings_migration_t)();
+
+// settings_migrations[n] brings layout n up to n + 1
+static const settings_migration_t settings_migrations[SETTINGS_VERSION] = {
+    _settings_migrate_0_to_1,
+    _settings_migrate_1_to_2,
+    _settings_migrate_2_to_3,
+};
+
+int _settings_read_version()
+{
+    unsigned char version = eeprom_read_char(SETTINGS_VERSION_LOC);
+    return version == 0xff ? 0 : version;
+}
+
+void _settings_write_home(char key, int value)
+{
+    int position = _settings_home_position(key);
+    if (key >= SETTINGS_LOG_MAX_ACCEL) {
+        settings_compacted_regions |= 1 << (1 + key - SETTINGS_LOG_MAX_ACCEL);
+    } else if (key >= SETTINGS_LOG_MAX_SPEED) {
+        settings_compacted_regions |= 1 << (1 + key - SETTINGS_LOG_MAX_SPEED);
+    } else {
+        settings_compacted_regions |= 1;
+    }
+
+    if (key == SETTINGS_LOG_PRESET_INDEX) {
+        eeprom_write_char(position, value);
+    } else {
+        eeprom_write_int16(position, value);
+    }
+}
+
+void _settings_compact()
+{
+    // the marker lets startup tell a compaction cut short by a power loss,
+    // with some regions rewritten but not yet sealed, from corruption
+    if (!settings_log_compacting()) {
+        settings_log_append(SETTINGS_LOG_COMPACTING, 0);
+    }
+
+    settings_compacted_regions = 0;
+    settings_log_replay(SETTINGS_LOG_ALL_KEYS, _settings_write_home);
+    if (settings_compacted_regions & 1) {
+        _settings_seal_globals();
+    }
+    for (int i = 0; i < MAX_PROFILES; ++i) {
+        if (settings_compacted_regions & (1 << (1 + i))) {
+            _settings_seal_profile(i);
+        }
+    }
+
+    settings_log_checkpoint();
+}
+
+void _settings_log(char key, int value)
+{
+    if (settings_log_full()) {
+        _settings_compact();
+    }
+    settings_log_append(key, value);
+}
+
+void _settings_apply_global(char key, int value)
+{
+    if (key >= SETTINGS_LOG_SAVED_POSITION) {
+        settings_state.saved_positions[key - SETTINGS_LOG_SAVED_POSITION] =
+            value;
+        return;
+    }
+
+    switch (key) {
+    case (SETTINGS_LOG_PRESET_INDEX): {
+        settings_state.preset_index = _settings_clamp_preset_index(value);
+    } break;
+    case (SETTINGS_LOG_CHANNEL): {
+        settings_state.channel = value;
+    } break;
+    case (SETTINGS_LOG_CAL_POS_1): {
+        settings_state.calibration_position_1 = value;
+    } break;
+    case (SETTINGS_LOG_CAL_POS_2): {
+        settings_state.calibration_position_2 = value;
+    } break;
+    case (SETTINGS_LOG_START_IN_CAL): {
+        settings_state.start_in_calibration_mode = (bool)value;
+    } break;
+    }
+}
+
+void _settings_apply_preset(char key, int value)
+{
+    if (key >= SETTINGS_LOG_MAX_ACCEL) {
+        settings_state.saved_max_accel = value;
+    } else {
+        settings_state.saved_max_speed = (uint16_t)value;
+    }
+}
+
+void _settings_load_preset()
+{
+    settings_state.id =
+        eeprom_read_uint32(_settings_position(ID_OFFSET, ID_SIZE));
+    eeprom_read_string(_settings_position(NAME_OFFSET, NAME_SIZE),
+        settings_state.name, NAME_MAX_LENGTH);
+    settings_state.saved_max_speed =
+        eeprom_read_uint16(_settings_position(MAX_SPEED_OFFSET, MAX_SPEED_SIZE));
+    settings_state.saved_max_accel =
+        eeprom_read_int16(_settings_position(MAX_ACCEL_OFFSET, MAX_ACCEL_SIZE));
+    settings_log_replay(SETTINGS_LOG_PRESET_KEYS(settings_state.preset_index),
+        _settings_apply_preset);
+    settings_state.debounced_max_speed = settings_state.saved_max_speed;
+    settings_state.debounced_max_accel = settings_state.saved_max_accel;
+}
+
+char settings_get_preset_index()
+{
+    return settings_state.preset_index;
+}
+
 void settings_set_preset_index(char index)
 {
     settings_flush_debounced_values();
-    eeprom_write_char(PRESET_INDEX_OFFSET, index);
-    settings_state.debounced_max_speed =
-        eeprom_read_uint16(
-            _settings_position(index, MAX_SPEED_OFFSET, MAX_SPEED_SIZE));
-    settings_state.debounced_max_accel =
-        eeprom_read_int16(
-            _settings_position(index, MAX_ACCEL_OFFSET, MAX_ACCEL_SIZE));
+    settings_state.preset_index = _settings_clamp_preset_index(index);
+    // read the new preset before its record queues up, so the reads don't
+    // wait for it to be programmed
+    eeprom_hold();
+    _settings_load_preset();
+    eeprom_release();
+    _settings_log(SETTINGS_LOG_PRESET_INDEX, settings_state.preset_index);
 }
 
 void settings_reset_to_defaults() {
     eeprom_write_uint32(SENTINEL_LOC, 0);
+    eeprom_flush();
 }
 
 void settings_init()
 {
-    unsigned long sentinel = eeprom_read_uint32(SENTINEL_LOC);
-    if (sentinel != SENTINEL_VALUE) {
+    settings_log_init();
+
+    int version = _settings_read_version();
+    if (eeprom_read_uint32(SENTINEL_LOC) != SENTINEL_VALUE ||
+        version > SETTINGS_VERSION) {
+        // never initialized, or laid out by firmware newer than us
+        _settings_default_globals();
         for (int i = 0; i < MAX_PROFILES; ++i) {
-            eeprom_write_uint16(
-                _settings_position(i, MAX_SPEED_OFFSET, MAX_SPEED_SIZE),
-                DEFAULT_MAX_SPEED);
-            eeprom_write_int16(
-                _settings_position(i, MAX_ACCEL_OFFSET, MAX_ACCEL_SIZE),
-                DEFAULT_MAX_ACCEL * 4);
-            eeprom_write_uint32(
-                _settings_position(i, ID_OFFSET, ID_SIZE),
-                DEFAULT_ID_SEED + (long)i);
-            eeprom_write_string(
-                _settings_position(i, NAME_OFFSET, NAME_SIZE),
-                DEFAULT_NAME, NAME_MAX_LENGTH);
+            _settings_default_profile(i);
         }
 
-        eeprom_write_int16(CAL_POS_1_OFFSET, DEFAULT_CAL_POS_1);
-        eeprom_write_int16(CAL_POS_2_OFFSET, DEFAULT_CAL_POS_2);
+        settings_log_erase();
+        settings_log_checkpoint();
 
-        eeprom_write_int16(SAVED_POSITION_OFFSET + 0, DEFAULT_SAVED_POSITION);
-        eeprom_write_int16(SAVED_POSITION_OFFSET + 2, DEFAULT_SAVED_POSITION);
-        eeprom_write_int16(SAVED_POSITION_OFFSET + 4, DEFAULT_SAVED_POSITION);
-        eeprom_write_int16(SAVED_POSITION_OFFSET + 6, DEFAULT_SAVED_POSITION);
-        eeprom_write_int16(START_IN_CAL_OFFSET, DEFAULT_START_IN_CAL);
+        eeprom_write_char(SETTINGS_VERSION_LOC, SETTINGS_VERSION);
+        eeprom_write_uint32(SENTINEL_LOC, SENTINEL_VALUE);
+    } else {
+        for (; version < SETTINGS_VERSION; ++version) {
+            settings_migrations[version]();
+            eeprom_write_char(SETTINGS_VERSION_LOC, version + 1);
+        }
 
-        eeprom_write_int16(CHANNEL_OFFSET, DEFAULT_CHANNEL);
+        if (settings_log_compacting()) {
+            _settings_compact();
+        }
 
-        eeprom_write_char(PRESET_INDEX_OFFSET, 0);
-        eeprom_write_uint32(SENTINEL_LOC, SENTINEL_VALUE);
+        if (!_settings_globals_valid()) {
+            _settings_default_globals();
+        }
+        for (int i = 0; i < MAX_PROFILES; ++i) {
+            if (!_settings_profile_valid(i)) {
+                _settings_default_profile(i);
+            }
+        }
+    }
+
+    settings_reload();
+}
+
+void settings_reload()
+{
+    settings_state.preset_index =
+        _settings_clamp_preset_index(eeprom_read_char(PRESET_INDEX_OFFSET));
+    settings_state.channel = eeprom_read_int16(CHANNEL_OFFSET);
+    settings_state.calibration_position_1 = eeprom_read_int16(CAL_POS_1_OFFSET);
+    settings_state.calibration_position_2 = eeprom_read_int16(CAL_POS_2_OFFSET);
+    settings_state.start_in_calibration_mode =
+        (bool)eeprom_read_int16(START_IN_CAL_OFFSET);
+    for (int i = 0; i < NUM_SAVED_POSITIONS; ++i) {
+        settings_state.saved_positions[i] =
+            eeprom_read_int16(SAVED_POSITION_OFFSET + (i * sizeof(int16_t)));
+        settings_state.saved_durations[i] =
+            eeprom_read_uint16(_settings_saved_duration_position(i));
     }
+    int count = eeprom_read_int16(CAL_POINT_COUNT_OFFSET);
+    settings_state.calibration_point_count =
+        count < 0 || count > CAL_MAX_INNER_POINTS ? 0 : count;
+    for (int i = 0; i < settings_state.calibration_point_count; ++i) {
+        int position = _settings_calibration_point_position(i);
+        settings_state.calibration_point_pots[i] = eeprom_read_int16(position);
+        settings_state.calibration_point_positions[i] =
+            eeprom_read_int16(position + sizeof(int16_t));
+    }
+    settings_log_replay(SETTINGS_LOG_GLOBAL_KEYS, _settings_apply_global);
+    _settings_load_preset();
+}
 
-    char preset = settings_get_preset_index();
-    settings_state.debounced_max_speed =
-        eeprom_read_uint16(_settings_position(preset,
-            MAX_SPEED_OFFSET, MAX_SPEED_SIZE));
-    settings_state.debounced_max_accel =
-        eeprom_read_int16(_settings_position(preset,
-            MAX_ACCEL_OFFSET, MAX_ACCEL_SIZE));
+void settings_compact()
+{
+    if (settings_log_pending() > 0) {
+        _settings_compact();
+    }
+}
+
+void settings_update_checksums()
+{
+    _settings_seal_globals();
+    for (int i = 0; i < MAX_PROFILES; ++i) {
+        _settings_seal_profile(i);
+    }
 }
 
 void settings_flush_debounced_values()
 {
     unsigned int max_speed = settings_state.debounced_max_speed;
-    unsigned int max_accel = settings_state.debounced_max_accel;
-    unsigned int existing_max_speed = 
-        eeprom_read_uint16(_settings_position(MAX_SPEED_OFFSET, MAX_SPEED_SIZE));
-    unsigned int existing_max_accel = 
-        eeprom_read_int16(_settings_position(MAX_ACCEL_OFFSET, MAX_ACCEL_SIZE));
+    int max_accel = settings_state.debounced_max_accel;
 
-    if (existing_max_speed != max_speed) {
-        eeprom_write_uint16(
-            _settings_position(MAX_SPEED_OFFSET, MAX_SPEED_SIZE), max_speed);   
+    if (settings_state.saved_max_speed != max_speed) {
+        _settings_log(SETTINGS_LOG_MAX_SPEED + settings_state.preset_index,
+            max_speed);
+        settings_state.saved_max_speed = max_speed;
     }
-    if (existing_max_accel != max_accel) {
-        eeprom_write_int16(
-            _settings_position(MAX_ACCEL_OFFSET, MAX_ACCEL_SIZE), max_accel);   
+    if (settings_state.saved_max_accel != max_accel) {
+        _settings_log(SETTINGS_LOG_MAX_ACCEL + settings_state.preset_index,
+            max_accel);
+        settings_state.saved_max_accel = max_accel;
     }
 }
 
 unsigned long settings_get_id()
 {
-    return eeprom_read_uint32(_settings_position(ID_OFFSET, ID_SIZE));
+    return settings_state.id;
 }
 
 void settings_get_name(char* buffer)
 {
-    eeprom_read_string(
-        _settings_position(NAME_OFFSET, NAME_SIZE), buffer, NAME_MAX_LENGTH);
+    strcpy(buffer, settings_state.name);
 }
 
 int settings_get_channel()
 {
-    return eeprom_read_int16(CHANNEL_OFFSET);
+    return settings_state.channel;
 }
 
 int settings_get_calibration_position_1()
 {
-    return eeprom_read_int16(CAL_POS_1_OFFSET);
+    return settings_state.calibration_position_1;
 }
 
 int settings_get_calibration_position_2()
 {
-    return eeprom_read_int16(CAL_POS_2_OFFSET);
+    return settings_state.calibration_position_2;
 }
 
 bool settings_get_start_in_calibration_mode()
 {
-    return (bool)eeprom_read_int16(START_IN_CAL_OFFSET);
+    return settings_state.start_in_calibration_mode;
+}
+
+int settings_get_calibration_point_count()
+{
+    return settings_state.calibration_point_count;
+}
+
+void settings_get_calibration_point(int index, int* pot, int* position)
+{
+    *pot = settings_state.calibration_point_pots[index];
+    *position = settings_state.calibration_point_positions[index];
 }
 
 int settings_get_saved_position(int index)
 {
-    return eeprom_read_int16(SAVED_POSITION_OFFSET + (index * sizeof(int)));
+    return settings_state.saved_positions[index];
+}
+
+unsigned int settings_get_saved_duration(int index)
+{
+    return settings_state.saved_durations[index];
 }
 
 unsigned int settings_get_max_speed()
@@ -157,37 +493,72 @@ int settings_get_max_accel()
 void settings_set_id(unsigned long val)
 {
     eeprom_write_uint32(_settings_position(ID_OFFSET, ID_SIZE), val);
+    _settings_seal_profile(settings_state.preset_index);
+    settings_state.id = val;
 }
 
 void settings_set_name(char* val)
 {
     eeprom_write_string(_settings_position(NAME_OFFSET, NAME_SIZE),
         val, NAME_MAX_LENGTH);
+    _settings_seal_profile(settings_state.preset_index);
+    strncpy(settings_state.name, val, NAME_MAX_LENGTH);
+    settings_state.name[NAME_MAX_LENGTH] = 0;
 }
 
 void settings_set_channel(int val)
 {
-    eeprom_write_int16(CHANNEL_OFFSET, val);
+    _settings_log(SETTINGS_LOG_CHANNEL, val);
+    settings_state.channel = val;
 }
 
 void settings_set_calibration_position_1(int val)
 {
-    eeprom_write_int16(CAL_POS_1_OFFSET, val);
+    _settings_log(SETTINGS_LOG_CAL_POS_1, val);
+    settings_state.calibration_position_1 = val;
 }
 
 void settings_set_calibration_position_2(int val)
 {
-    eeprom_write_int16(CAL_POS_2_OFFSET, val);
+    _settings_log(SETTINGS_LOG_CAL_POS_2, val);
+    settings_state.calibration_position_2 = val;
 }
 
 void settings_set_start_in_calibration_mode(bool val)
 {
-    eeprom_write_int16(START_IN_CAL_OFFSET, val);
+    _settings_log(SETTINGS_LOG_START_IN_CAL, val);
+    settings_state.start_in_calibration_mode = val;
+}
+
+void settings_set_calibration_points(int count, const int* pots,
+                                     const int* positions)
+{
+    if (count > CAL_MAX_INNER_POINTS) {
+        count = CAL_MAX_INNER_POINTS;
+    }
+    for (int i = 0; i < count; ++i) {
+        int position = _settings_calibration_point_position(i);
+        eeprom_write_int16(position, pots[i]);
+        eeprom_write_int16(position + sizeof(int16_t), positions[i]);
+        settings_state.calibration_point_pots[i] = pots[i];
+        settings_state.calibration_point_positions[i] = positions[i];
+    }
+    eeprom_write_int16(CAL_POINT_COUNT_OFFSET, count);
+    _settings_seal_globals();
+    settings_state.calibration_point_count = count;
 }
 
 void settings_set_saved_position(int index, int val)
 {
-    eeprom_write_int16(SAVED_POSITION_OFFSET + (index * sizeof(int)), val);
+    _settings_log(SETTINGS_LOG_SAVED_POSITION + index, val);
+    settings_state.saved_positions[index] = val;
+}
+
+void settings_set_saved_duration(int index, unsigned int val)
+{
+    eeprom_write_uint16(_settings_saved_duration_position(index), val);
+    _settings_seal_globals();
+    settings_state.saved_durations[index] = val;
 }
 
 void settings_set_max_speed(unsigned int val)
@@ -6,6 +6,15 @@
 #define SENTINEL_LOC            00
 #define SENTINEL_VALUE          0xfafbul
 
+// the rest of the old settings area holds the schema header.
+// The globals and each profile carry their own CRC, so a region torn by a
+// brownout falls back to its defaults alone. Units from before versioning
+// have 0xff at SETTINGS_VERSION_LOC and are migrated forward at startup.
+#define SETTINGS_VERSION_LOC    4  // uint8
+#define SETTINGS_VERSION        3
+#define GLOBALS_CRC_LOC         6  // uint16
+#define PROFILE_CRC_LOC         8  // uint16[MAX_PROFILES]
+
 #define PROFILE_SETTINGS_START  128
 
 #define OLD_SETTINGS_END		32
@@ -27,6 +36,27 @@
 #define CHANNEL_OFFSET			48 // int16
 #define CHANNEL_SIZE			2  // int16
 
+// how long the move to each saved position should take, in ms;
+// 0 moves at the preset's speed and accel as before. Set from a computer
+// and not during a shoot, so these are written in place, not logged.
+#define SAVED_DURATION_OFFSET   50 // uint16[4]
+#define SAVED_DURATION_SIZE     8  // uint16[4]
+
+// the calibration points between the two ends, pot ascending,
+// each a pot reading and a motor position; the ends are CAL_POS_1 at
+// MIN_POT_VAL and CAL_POS_2 at MAX_POT_VAL. Written in place once at the
+// end of a calibration, not logged.
+#define CAL_MAX_INNER_POINTS    8
+#define CAL_POINT_COUNT_OFFSET  58 // int16
+#define CAL_POINT_COUNT_SIZE    2  // int16
+#define CAL_POINTS_OFFSET       60 // { int16 pot, int16 position }[8]
+#define CAL_POINTS_SIZE         32 // { int16 pot, int16 position }[8]
+
+#define GLOBALS_START           PRESET_INDEX_OFFSET
+#define GLOBALS_END             (CAL_POINTS_OFFSET + CAL_POINTS_SIZE)
+#define GLOBALS_END_V1          (CHANNEL_OFFSET + CHANNEL_SIZE)
+#define GLOBALS_END_V2          (SAVED_DURATION_OFFSET + SAVED_DURATION_SIZE)
+
 #define MAX_PROFILES            6
 
 // EEPROM locations for parameters
@@ -49,6 +79,7 @@
 #define DEFAULT_CAL_POS_1       0
 #define DEFAULT_CAL_POS_2       800
 #define DEFAULT_SAVED_POSITION  0
+#define DEFAULT_SAVED_DURATION  0
 #define DEFAULT_START_IN_CAL    0
 #define DEFAULT_MAX_SPEED       16384
 #define DEFAULT_MAX_ACCEL       32
@@ -58,12 +89,39 @@
 
 #define ENCODER_STEPS_PER_CLICK 4
 
+#define NUM_SAVED_POSITIONS     4
+
+// a RAM copy of everything the active preset reads, loaded at
+// settings_init() and kept current by the setters, so getters never touch
+// the EEPROM. Speed and accel are debounced: the setters only change RAM and
+// settings_flush_debounced_values() writes them out, comparing against
+// saved_max_speed/saved_max_accel instead of reading the EEPROM back.
 struct settings_state_t {
+    char preset_index;
+    unsigned long id;
+    char name[NAME_SIZE];
+    int channel;
+    int calibration_position_1;
+    int calibration_position_2;
+    bool start_in_calibration_mode;
+    int saved_positions[NUM_SAVED_POSITIONS];
+    unsigned int saved_durations[NUM_SAVED_POSITIONS];
+    int calibration_point_count;
+    int calibration_point_pots[CAL_MAX_INNER_POINTS];
+    int calibration_point_positions[CAL_MAX_INNER_POINTS];
     unsigned int debounced_max_speed;
     int debounced_max_accel;
+    unsigned int saved_max_speed;
+    int saved_max_accel;
 };
 
 void settings_init();
+void settings_reload();
+// Writes everything pending in the settings log (settings_log.h) back to the
+// fixed locations above, so the EEPROM can be read or patched in place.
+void settings_compact();
+// Recomputes every region's CRC, after the EEPROM was patched directly.
+void settings_update_checksums();
 void settings_flush_debounced_values();
 void settings_reset_to_defaults();
 
@@ -76,7 +134,11 @@ int settings_get_channel();
 int settings_get_calibration_position_1();
 int settings_get_calibration_position_2();
 bool settings_get_start_in_calibration_mode();
+// The points between the ends, see CAL_POINTS_OFFSET.
+int settings_get_calibration_point_count();
+void settings_get_calibration_point(int index, int* pot, int* position);
 int settings_get_saved_position(int index);
+unsigned int settings_get_saved_duration(int index);
 unsigned int settings_get_max_speed();
 int settings_get_max_accel();
 
@@ -86,7 +148,11 @@ void settings_set_channel(int val);
 void settings_set_calibration_position_1(int val);
 void settings_set_calibration_position_2(int val);
 void settings_set_start_in_calibration_mode(bool val);
+// Replaces all of them; count is cut back to CAL_MAX_INNER_POINTS.
+void settings_set_calibration_points(int count, const int* pots,
+                                     const int* positions);
 void settings_set_saved_position(int index, int val);
+void settings_set_saved_duration(int index, unsigned int val);
 void settings_set_max_speed(unsigned int val);
 void settings_set_max_accel(int val);
 
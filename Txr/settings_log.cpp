@@ -0,0 +1,178 @@
+#include <stdint.h>
+#include "settings_log.h"
+
+struct settings_log_state_t {
+    int head;               // slot of the newest record, -1 when empty
+    uint16_t seq;           // its sequence number
+    char key;               // its key
+    int pending;            // records since the last checkpoint
+};
+
+static settings_log_state_t settings_log_state = { -1, 0, 0, 0 };
+
+struct settings_log_record_t {
+    uint16_t seq;
+    char key;
+    int value;
+};
+
+int _settings_log_address(int slot)
+{
+    return SETTINGS_LOG_START + slot * SETTINGS_LOG_RECORD_SIZE;
+}
+
+int _settings_log_prev(int slot)
+{
+    return slot == 0 ? SETTINGS_LOG_RECORDS - 1 : slot - 1;
+}
+
+int _settings_log_next(int slot)
+{
+    return slot == SETTINGS_LOG_RECORDS - 1 ? 0 : slot + 1;
+}
+
+unsigned char _settings_log_crc(unsigned char* bytes, int count)
+{
+    unsigned char crc = 0;
+    for (int i = 0; i < count; ++i) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// records are packed by hand, the host builds would pad a struct
+bool _settings_log_read(int slot, settings_log_record_t* record)
+{
+    unsigned char bytes[SETTINGS_LOG_RECORD_SIZE];
+    eeprom_read_bytes(_settings_log_address(slot), bytes, sizeof(bytes));
+
+    record->seq = bytes[0] | (bytes[1] << 8);
+    record->key = bytes[2];
+    record->value = (int16_t)(bytes[3] | (bytes[4] << 8));
+
+    return _settings_log_crc(bytes, SETTINGS_LOG_RECORD_SIZE - 1) ==
+           bytes[SETTINGS_LOG_RECORD_SIZE - 1] &&
+           record->key >= 0 && record->key < SETTINGS_LOG_RECORD_KEYS;
+}
+
+void _settings_log_write(int slot, uint16_t seq, char key, int value)
+{
+    unsigned char bytes[SETTINGS_LOG_RECORD_SIZE];
+    bytes[0] = seq & 0xff;
+    bytes[1] = seq >> 8;
+    bytes[2] = key;
+    bytes[3] = value & 0xff;
+    bytes[4] = (value >> 8) & 0xff;
+    bytes[5] = _settings_log_crc(bytes, SETTINGS_LOG_RECORD_SIZE - 1);
+    eeprom_write_bytes(_settings_log_address(slot), bytes, sizeof(bytes));
+}
+
+void settings_log_init()
+{
+    settings_log_state.head = -1;
+    settings_log_state.seq = 0;
+    settings_log_state.key = 0;
+    settings_log_state.pending = 0;
+
+    // records are written to consecutive slots with consecutive sequence
+    // numbers, so the newest is the one not followed by its successor. A
+    // write torn by a power loss fails its crc and ends the run early.
+    settings_log_record_t record;
+    settings_log_record_t next;
+    for (int slot = 0; slot < SETTINGS_LOG_RECORDS; ++slot) {
+        if (!_settings_log_read(slot, &record)) {
+            continue;
+        }
+        if (!_settings_log_read(_settings_log_next(slot), &next) ||
+            next.seq != (uint16_t)(record.seq + 1)) {
+            settings_log_state.head = slot;
+            settings_log_state.seq = record.seq;
+            settings_log_state.key = record.key;
+            break;
+        }
+    }
+    if (settings_log_state.head < 0) {
+        return;
+    }
+
+    int slot = settings_log_state.head;
+    uint16_t seq = settings_log_state.seq;
+    while (settings_log_state.pending < SETTINGS_LOG_RECORDS - 1 &&
+           _settings_log_read(slot, &record) && record.seq == seq &&
+           record.key != SETTINGS_LOG_CHECKPOINT) {
+        ++settings_log_state.pending;
+        slot = _settings_log_prev(slot);
+        --seq;
+    }
+}
+
+void settings_log_erase()
+{
+    for (int i = SETTINGS_LOG_START; i < SETTINGS_LOG_END; ++i) {
+        eeprom_write_char(i, 0xff);
+    }
+    settings_log_state.head = -1;
+    settings_log_state.seq = 0;
+    settings_log_state.key = 0;
+    settings_log_state.pending = 0;
+}
+
+void settings_log_replay(unsigned long keys, settings_log_apply_t apply)
+{
+    // newest first, so the first record seen for a key is the one that counts
+    unsigned long seen = 0;
+    int slot = settings_log_state.head;
+    settings_log_record_t record;
+    for (int i = 0; i < settings_log_state.pending; ++i) {
+        _settings_log_read(slot, &record);
+        unsigned long bit = record.key < SETTINGS_LOG_KEYS ?
+            SETTINGS_LOG_KEY_BIT(record.key) : 0;
+        if ((keys & bit) && !(seen & bit)) {
+            seen |= bit;
+            apply(record.key, record.value);
+        }
+        slot = _settings_log_prev(slot);
+    }
+}
+
+bool settings_log_full()
+{
+    // the last checkpoint has to survive until the next one is written,
+    // which takes the compacting record and the checkpoint itself
+    return settings_log_state.pending >= SETTINGS_LOG_RECORDS - 2;
+}
+
+bool settings_log_compacting()
+{
+    return settings_log_state.head >= 0 &&
+           settings_log_state.key == SETTINGS_LOG_COMPACTING;
+}
+
+int settings_log_pending()
+{
+    return settings_log_state.pending;
+}
+
+void settings_log_append(char key, int value)
+{
+    int slot = _settings_log_next(settings_log_state.head);
+    uint16_t seq = settings_log_state.seq + 1;
+    _settings_log_write(slot, seq, key, value);
+
+    settings_log_state.head = slot;
+    settings_log_state.seq = seq;
+    settings_log_state.key = key;
+    if (key == SETTINGS_LOG_CHECKPOINT) {
+        settings_log_state.pending = 0;
+    } else {
+        ++settings_log_state.pending;
+    }
+}
+
+void settings_log_checkpoint()
+{
+    settings_log_append(SETTINGS_LOG_CHECKPOINT, 0);
+}
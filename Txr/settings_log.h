@@ -0,0 +1,72 @@
+#ifndef settings_log_h
+#define settings_log_h
+
+#include "eeprom_helpers.h"
+
+// the settings that change during a shoot (speed and accel per
+// preset, the saved positions, the active preset...) are not rewritten in
+// place. Each change is appended to a ring of small records in the free
+// EEPROM above the profiles, so the writes walk across the whole region
+// instead of hammering the same few cells. Every record carries a sequence
+// number; the newest record for a key wins. When the ring is about to
+// overwrite records that are still live, settings.cpp compacts: it writes
+// the newest value of every key back to its fixed location and appends a
+// checkpoint, after which the older records no longer count.
+//
+// record: seq (uint16) | key (uint8) | value (int16) | crc8
+#define SETTINGS_LOG_START          528
+#define SETTINGS_LOG_END            EEPROM_MAX_ADDR
+#define SETTINGS_LOG_RECORD_SIZE    6
+#define SETTINGS_LOG_RECORDS \
+    ((SETTINGS_LOG_END - SETTINGS_LOG_START) / SETTINGS_LOG_RECORD_SIZE)
+
+enum {
+    SETTINGS_LOG_CHECKPOINT,
+    SETTINGS_LOG_PRESET_INDEX,
+    SETTINGS_LOG_CHANNEL,
+    SETTINGS_LOG_CAL_POS_1,
+    SETTINGS_LOG_CAL_POS_2,
+    SETTINGS_LOG_START_IN_CAL,
+    SETTINGS_LOG_SAVED_POSITION,    // + index, 4 keys
+    SETTINGS_LOG_MAX_SPEED = SETTINGS_LOG_SAVED_POSITION + 4,   // + preset
+    SETTINGS_LOG_MAX_ACCEL = SETTINGS_LOG_MAX_SPEED + 6,        // + preset
+    SETTINGS_LOG_KEYS = SETTINGS_LOG_MAX_ACCEL + 6,
+    // written before a compaction touches the fixed locations; finding it
+    // newest at startup means the compaction was cut short
+    SETTINGS_LOG_COMPACTING = SETTINGS_LOG_KEYS,
+    SETTINGS_LOG_RECORD_KEYS,
+};
+
+#define SETTINGS_LOG_KEY_BIT(key)   (1ul << (key))
+#define SETTINGS_LOG_ALL_KEYS \
+    ((SETTINGS_LOG_KEY_BIT(SETTINGS_LOG_KEYS) - 1) & \
+     ~SETTINGS_LOG_KEY_BIT(SETTINGS_LOG_CHECKPOINT))
+#define SETTINGS_LOG_GLOBAL_KEYS \
+    ((SETTINGS_LOG_KEY_BIT(SETTINGS_LOG_MAX_SPEED) - 1) & \
+     ~SETTINGS_LOG_KEY_BIT(SETTINGS_LOG_CHECKPOINT))
+#define SETTINGS_LOG_PRESET_KEYS(preset) \
+    (SETTINGS_LOG_KEY_BIT(SETTINGS_LOG_MAX_SPEED + (preset)) | \
+     SETTINGS_LOG_KEY_BIT(SETTINGS_LOG_MAX_ACCEL + (preset)))
+
+typedef void (*settings_log_apply_t)(char key, int value);
+
+// Finds the newest record. Called once at startup, before any replay.
+void settings_log_init();
+// Invalidates every record, for a factory reset.
+void settings_log_erase();
+
+// Calls apply with the newest value of each key in keys (a mask of
+// SETTINGS_LOG_KEY_BIT) written since the last checkpoint.
+void settings_log_replay(unsigned long keys, settings_log_apply_t apply);
+
+// True when a compaction (two records) would overwrite a live record.
+bool settings_log_full();
+// True when the newest record is SETTINGS_LOG_COMPACTING.
+bool settings_log_compacting();
+// Number of records since the last checkpoint.
+int settings_log_pending();
+
+void settings_log_append(char key, int value);
+void settings_log_checkpoint();
+
+#endif  // settings_log_h
@@ -0,0 +1,313 @@
+#include "take.h"
+
+// a take is either being recorded or being replayed, never
+// both, so the coder state below serves whichever is going on
+struct take_state_t {
+    unsigned char codes[TAKE_BUFFER_SIZE];
+    int length;             // bytes of codes
+    long start;             // the first sample
+    char mode;
+    bool first;             // the next sample is the first
+    int index;              // next code to replay
+    int run;                // zero residuals not yet written or replayed
+    bool held;              // a residual not yet written or replayed
+    int held_residual;
+    long pos;               // the last sample as the codes rebuild it
+    long speed;             // and its change from the one before
+};
+
+static take_state_t take_state;
+
+int _take_sign_extend(unsigned int value, int bits)
+{
+    int sign = 1 << (bits - 1);
+    return (int)(value & ((1u << bits) - 1)) - ((value & sign) ? sign << 1 : 0);
+}
+
+void _take_rewind()
+{
+    take_state_t* s = &take_state;
+    s->first = true;
+    s->index = 0;
+    s->run = 0;
+    s->held = false;
+    s->pos = s->start;
+    s->speed = 0;
+}
+
+// Both sides rebuild the sample the same way from the residual.
+void _take_apply(long residual)
+{
+    take_state_t* s = &take_state;
+    s->pos += s->speed + residual;
+    if (residual == TAKE_RESIDUAL_MIN || residual == TAKE_RESIDUAL_MAX) {
+        s->speed = 0;
+    } else {
+        s->speed += residual;
+    }
+}
+
+bool _take_put(int count, unsigned char first, unsigned char second)
+{
+    take_state_t* s = &take_state;
+    // once one code doesn't fit, a shorter one mustn't slip in after it
+    if (s->mode != TAKE_RECORDING) {
+        return false;
+    }
+    if (s->length + count > TAKE_BUFFER_SIZE) {
+        s->mode = TAKE_IDLE;
+        return false;
+    }
+    s->codes[s->length++] = first;
+    if (count > 1) {
+        s->codes[s->length++] = second;
+    }
+    return true;
+}
+
+void _take_put_run()
+{
+    take_state_t* s = &take_state;
+    if (s->run) {
+        _take_put(1, 0x80 | (s->run - 1), 0);
+        s->run = 0;
+    }
+}
+
+void _take_put_single(int residual)
+{
+    if (residual >= -16 && residual <= 15) {
+        _take_put(1, 0x20 | (residual & 0x1f), 0);
+    } else {
+        _take_put(2, (residual >> 8) & 0x1f, residual & 0xff);
+    }
+}
+
+bool _take_small(int residual)
+{
+    return residual >= -4 && residual <= 3;
+}
+
+bool _take_get(long* residual)
+{
+    take_state_t* s = &take_state;
+    if (s->run) {
+        --s->run;
+        *residual = 0;
+        return true;
+    }
+    if (s->held) {
+        s->held = false;
+        *residual = s->held_residual;
+        return true;
+    }
+    if (s->index >= s->length) {
+        return false;
+    }
+
+    unsigned char code = s->codes[s->index++];
+    if (code & 0x80) {
+        s->run = code & 0x7f;
+        *residual = 0;
+    } else if (code & 0x40) {
+        *residual = _take_sign_extend(code >> 3, 3);
+        s->held = true;
+        s->held_residual = _take_sign_extend(code, 3);
+    } else if (code & 0x20) {
+        *residual = _take_sign_extend(code, 5);
+    } else {
+        if (s->index >= s->length) {
+            return false;
+        }
+        *residual = _take_sign_extend((code << 8) | s->codes[s->index++], 13);
+    }
+    return true;
+}
+
+int take_mode()
+{
+    return take_state.mode;
+}
+
+bool take_replaying()
+{
+    return take_state.mode == TAKE_CUED || take_state.mode == TAKE_PLAYING;
+}
+
+void take_record()
+{
+    take_state.mode = TAKE_RECORDING;
+    take_state.length = 0;
+    _take_rewind();
+}
+
+void take_stop()
+{
+    take_state_t* s = &take_state;
+    if (s->mode == TAKE_RECORDING) {
+        _take_put_run();
+        if (s->held) {
+            _take_put_single(s->held_residual);
+            s->held = false;
+        }
+    }
+    s->mode = TAKE_IDLE;
+}
+
+bool take_cue()
+{
+    if (take_state.mode == TAKE_RECORDING || !take_state.length) {
+        return false;
+    }
+    take_state.mode = TAKE_CUED;
+    return true;
+}
+
+bool take_play()
+{
+    if (take_state.mode == TAKE_RECORDING || !take_state.length) {
+        return false;
+    }
+    take_state.mode = TAKE_PLAYING;
+    _take_rewind();
+    return true;
+}
+
+void take_sample(long pos)
+{
+    take_state_t* s = &take_state;
+    if (s->mode != TAKE_RECORDING) {
+        return;
+    }
+    if (s->first) {
+        s->first = false;
+        s->start = s->pos = pos;
+        return;
+    }
+
+    long residual = pos - (s->pos + s->speed);
+    if (residual < TAKE_RESIDUAL_MIN) {
+        residual = TAKE_RESIDUAL_MIN;
+    } else if (residual > TAKE_RESIDUAL_MAX) {
+        residual = TAKE_RESIDUAL_MAX;
+    }
+    _take_apply(residual);
+
+    // a small residual waits for a second one to share its byte
+    int r = (int)residual;
+    if (s->held) {
+        s->held = false;
+        if (_take_small(r)) {
+            _take_put(1, 0x40 | ((s->held_residual & 7) << 3) | (r & 7), 0);
+            return;
+        }
+        _take_put_single(s->held_residual);
+    }
+    if (r == 0) {
+        if (++s->run == 128) {
+            _take_put_run();
+        }
+        return;
+    }
+    _take_put_run();
+    if (_take_small(r)) {
+        s->held = true;
+        s->held_residual = r;
+    } else {
+        _take_put_single(r);
+    }
+}
+
+bool take_next(long* pos)
+{
+    take_state_t* s = &take_state;
+    if (s->mode == TAKE_CUED) {
+        *pos = s->start;
+        return true;
+    }
+    if (s->mode != TAKE_PLAYING) {
+        return false;
+    }
+
+    if (s->first) {
+        s->first = false;
+    } else {
+        long residual;
+        if (!_take_get(&residual)) {
+            s->mode = TAKE_IDLE;
+            return false;
+        }
+        _take_apply(residual);
+    }
+    *pos = s->pos;
+    return true;
+}
+
+int take_samples()
+{
+    take_state_t* s = &take_state;
+    if (!s->length) {
+        return 0;
+    }
+
+    int samples = 1;
+    for (int i = 0; i < s->length; ++i) {
+        unsigned char code = s->codes[i];
+        if (code & 0x80) {
+            samples += (code & 0x7f) + 1;
+        } else if (code & 0x40) {
+            samples += 2;
+        } else {
+            if (!(code & 0x20)) {
+                ++i;
+            }
+            ++samples;
+        }
+    }
+    return samples;
+}
+
+int take_length()
+{
+    return take_state.length;
+}
+
+void take_read_image(int start, unsigned char* bytes, int count)
+{
+    take_state_t* s = &take_state;
+    for (int i = 0; i < count; ++i) {
+        int at = start + i;
+        if (at < 4) {
+            bytes[i] = (s->start >> (8 * at)) & 0xff;
+        } else if (at < TAKE_HEADER_SIZE) {
+            bytes[i] = ((unsigned int)s->length >> (8 * (at - 4))) & 0xff;
+        } else {
+            bytes[i] = s->codes[at - TAKE_HEADER_SIZE];
+        }
+    }
+}
+
+void take_write_image(int start, const unsigned char* bytes, int count)
+{
+    take_state_t* s = &take_state;
+    s->mode = TAKE_IDLE;
+
+    unsigned long first = s->start;
+    unsigned int length = s->length;
+    for (int i = 0; i < count; ++i) {
+        int at = start + i;
+        if (at < 4) {
+            int shift = 8 * at;
+            first = (first & ~(0xfful << shift)) |
+                ((unsigned long)bytes[i] << shift);
+        } else if (at < TAKE_HEADER_SIZE) {
+            int shift = 8 * (at - 4);
+            length = (length & ~(0xffu << shift)) |
+                ((unsigned int)bytes[i] << shift);
+        } else {
+            s->codes[at - TAKE_HEADER_SIZE] = bytes[i];
+        }
+    }
+    s->start = (long)first;
+    s->length = length > TAKE_BUFFER_SIZE ? TAKE_BUFFER_SIZE : length;
+}
@@ -0,0 +1,78 @@
+#ifndef take_h
+#define take_h
+
+// a take is a recorded focus pull. While recording, cur_pos_ is
+// sampled on every SEND_TIMEOUT_SIG (128 Hz) and each sample is stored as
+// its difference from a prediction that carries the previous sample's
+// speed on, so holds and steady pulls both come out as runs of zeros. A
+// replay hands the samples back on the same timer as play-back targets, and
+// send_position() puts them on the air as PACKET_AXES_TARGET_SET.
+//
+// codes, residual = sample - (previous sample + previous speed):
+//   1nnnnnnn             n + 1 zero residuals
+//   01aaabbb             two residuals, each -4..3
+//   001rrrrr             one residual, -16..15
+//   000rrrrr rrrrrrrr    one residual, -4096..4095
+// A bigger residual is clamped and the rest caught up over the next
+// samples; a clamped residual also zeroes the speed, so a jump is walked
+// toward instead of overshot.
+//
+// A smooth pull costs half to two thirds of a byte a sample and a hold one
+// byte in 128 samples, so the buffer holds about 4.5 s of continuous motion
+// and a good deal more of the stops and starts of a real take. It's the
+// biggest thing in RAM; see the budget in Txr.h. A Q_SPY build hands most
+// of its share to the QS trace buffer (bsp.cpp), leaving about 1.5 s.
+#define TAKE_RAM_SHARE      384
+#ifdef Q_SPY
+#define TAKE_BUFFER_SIZE    128
+#else
+#define TAKE_BUFFER_SIZE    TAKE_RAM_SHARE
+#endif
+#define TAKE_RESIDUAL_MIN   (-4096)
+#define TAKE_RESIDUAL_MAX   4095
+// there's no room left in the EEPROM for a take, so it's saved
+// off the unit instead ('E'/'L'), as an image of
+//   start position (int32) | code length (uint16) | codes
+#define TAKE_HEADER_SIZE    6
+#define TAKE_IMAGE_SIZE     (TAKE_HEADER_SIZE + TAKE_BUFFER_SIZE)
+
+enum {
+    TAKE_IDLE,
+    TAKE_RECORDING,
+    TAKE_CUED,          // holding the first sample until take_play()
+    TAKE_PLAYING,
+};
+
+int take_mode();
+// Cued or playing.
+bool take_replaying();
+
+// Starts recording over the current take, from the next take_sample().
+void take_record();
+// Ends a recording or a replay.
+void take_stop();
+// Sends the motor to the take's first sample and holds it there. False,
+// changing nothing, when there is no take or one is being recorded.
+bool take_cue();
+// Replays from the first sample. Same failures as take_cue().
+bool take_play();
+
+// Called once per sample. Recording, appends pos; the recording ends on
+// its own when the buffer fills.
+void take_sample(long pos);
+// Called once per sample. Cued or playing, sets pos to the sample to move
+// to and returns true; at the end of a replay it goes back to idle, leaving
+// the last sample where it was.
+bool take_next(long* pos);
+
+// Samples stored, 0 for no take.
+int take_samples();
+// Bytes of codes stored.
+int take_length();
+
+void take_read_image(int start, unsigned char* bytes, int count);
+// Ends any recording or replay first. A code length past the buffer is
+// cut back to it.
+void take_write_image(int start, const unsigned char* bytes, int count);
+
+#endif // take_h
@@ -0,0 +1,109 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// Just enough of the Arduino core to compile the Rxr and Txr sources on a
+// Linux host. Pins and PWM are no-ops, Serial is backed by a file descriptor
+// and EEPROM by a RAM array (see EEPROM.h).
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH            0x1
+#define LOW             0x0
+
+#define INPUT           0x0
+#define OUTPUT          0x1
+#define INPUT_PULLUP    0x2
+
+#define A0              18
+#define A1              19
+#define A2              20
+#define A3              21
+#define A4              22
+#define A5              23
+
+#define F_CPU           16000000UL
+
+#ifndef min
+#define min(a,b)        ((a)<(b)?(a):(b))
+#endif
+#ifndef max
+#define max(a,b)        ((a)>(b)?(a):(b))
+#endif
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+
+// ao_Txr.cpp brings its own map(), same as on the target.
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+class HardwareSerial {
+public:
+    HardwareSerial() : fd_(-1) {}
+
+    void begin(unsigned long baud);
+    void end();
+    int available();
+    int read();
+    size_t write(uint8_t byte);
+    size_t write(const char *buffer, size_t length);
+    size_t write(const uint8_t *buffer, size_t length);
+    size_t print(const char *str);
+
+    // host only: attach the port to an open tty, pty or pipe
+    void attach(int fd);
+    int fd() const { return fd_; }
+
+private:
+    int fd_;
+};
+
+extern HardwareSerial Serial;
+
+// host only: the pin state last written by analogWrite/digitalWrite, and the
+// value analogRead/digitalRead will report for an input pin
+struct host_pins_t {
+    int analog_in[32];
+    int digital_in[32];
+    int analog_out[32];
+    int digital_out[32];
+    unsigned long analog_writes;
+};
+
+extern host_pins_t host_pins;
+
+// host only: with virtual time on, millis() and micros() start from zero and
+// move only when host_advance_micros() or delay() moves them, so a simulation
+// runs as fast as the host can go and comes out the same every run
+void host_use_virtual_time(bool on);
+void host_advance_micros(unsigned long us);
+
+#endif // Arduino_h
@@ -0,0 +1,39 @@
+#ifndef host_EEPROM_h
+#define host_EEPROM_h
+
+#include <stdint.h>
+
+#define HOST_EEPROM_SIZE 1024
+// how long a write keeps the EEPROM busy, under virtual time only
+#define HOST_EEPROM_WRITE_US 3400
+
+// The ATmega32u4's 1 KB EEPROM, erased to 0xff like a fresh part. Every
+// cell keeps a write counter so host tools can look at wear. Under virtual
+// time (Arduino.h) a write keeps the part busy for HOST_EEPROM_WRITE_US, and
+// read() and write() wait that out first, as avr-libc does; every
+// EEPROMClass shares the one busy flag, like the registers.
+class EEPROMClass {
+public:
+    EEPROMClass();
+
+    uint8_t read(int addr);
+    void write(int addr, uint8_t value);
+    void update(int addr, uint8_t value);
+    int length() { return HOST_EEPROM_SIZE; }
+
+    // host only
+    void erase();
+    uint8_t cells[HOST_EEPROM_SIZE];
+    unsigned long writes[HOST_EEPROM_SIZE];
+};
+
+extern EEPROMClass EEPROM;
+
+// host only: whether a write is still being programmed
+bool host_eeprom_busy();
+// host only: EE_READY_vect, when the firmware has one, as the part would
+// take it: over and over while EERIE is set and the EEPROM is idle. The
+// host runs it when EERIE is set and as the clock passes the end of a write.
+void host_eeprom_interrupt();
+
+#endif // host_EEPROM_h
@@ -0,0 +1,84 @@
+// Host replacement for libraries/Mirf. The radio is modeled at the payload
+// level: send() hands the payload to a pluggable link and received payloads
+// are queued by the link with host_receive(), so the real radio.cpp of either
+// unit runs unmodified on top of it. Of the addressing, pipes 1 and 2 are
+// modeled, so a link can ask host_listens() whether a payload would get
+// through.
+
+#ifndef _MIRF_H_
+#define _MIRF_H_
+
+#include <Arduino.h>
+
+#include "nRF24L01.h"
+#include "MirfSpiDriver.h"
+
+#define mirf_ADDR_LEN   5
+#define mirf_CONFIG     ((1<<EN_CRC) | (0<<CRCO))
+
+#define HOST_MIRF_PAYLOAD_MAX   32
+#define HOST_MIRF_RX_FIFO       3
+
+struct host_mirf_link_t {
+    void (*send)(void *context, const uint8_t *addr,
+                 const uint8_t *payload, uint8_t length);
+    void *context;
+};
+
+class Nrf24l {
+public:
+    Nrf24l();
+
+    void init();
+    void config();
+    void send(uint8_t *value);
+    void setRADDR(uint8_t *adr);
+    void setTADDR(uint8_t *adr);
+    bool dataReady();
+    bool isSending();
+    bool rxFifoEmpty();
+    bool txFifoEmpty();
+    void getData(uint8_t *data);
+    uint8_t getStatus();
+
+    void configRegister(uint8_t reg, uint8_t value);
+    void readRegister(uint8_t reg, uint8_t *value, uint8_t len);
+    void writeRegister(uint8_t reg, uint8_t *value, uint8_t len);
+    void powerUpRx();
+    void powerUpTx();
+    void powerDown();
+    void flushRx();
+
+    uint8_t PTX;
+    uint8_t cePin;
+    uint8_t csnPin;
+    uint8_t channel;
+    uint8_t payload;
+    MirfSpiDriver *spi;
+
+    // host only: queue a payload as if it had arrived over the air. Returns
+    // false when the RX FIFO is full and the payload was dropped.
+    bool host_receive(const uint8_t *data, uint8_t length);
+    // host only: whether a payload sent to addr lands on an enabled pipe
+    bool host_listens(const uint8_t *addr);
+
+    host_mirf_link_t link;
+    uint8_t rx_addr[mirf_ADDR_LEN];
+    uint8_t tx_addr[mirf_ADDR_LEN];
+    uint8_t rx_addr_p2;         // the first byte, the rest is pipe 1's
+    uint8_t en_rxaddr;
+    uint8_t en_aa;
+    uint8_t rf_setup;
+    unsigned long sent;
+    unsigned long received;
+    unsigned long dropped;
+
+private:
+    uint8_t rx_fifo_[HOST_MIRF_RX_FIFO][HOST_MIRF_PAYLOAD_MAX];
+    int rx_head_;
+    int rx_count_;
+};
+
+extern Nrf24l Mirf;
+
+#endif // _MIRF_H_
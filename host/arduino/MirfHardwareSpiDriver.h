@@ -0,0 +1,17 @@
+#ifndef __MIRF_HARDWARE_SPI_DRIVER
+#define __MIRF_HARDWARE_SPI_DRIVER
+
+#include "MirfSpiDriver.h"
+
+// The host Nrf24l never clocks SPI; this only exists so radio_init() can
+// keep assigning Mirf.spi.
+class MirfHardwareSpiDriver : public MirfSpiDriver {
+public:
+    virtual uint8_t transfer(uint8_t data) { return data; }
+    virtual void begin() {}
+    virtual void end() {}
+};
+
+extern MirfHardwareSpiDriver MirfHardwareSpi;
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef __MIRF_SPI_DRIVER
+#define __MIRF_SPI_DRIVER
+
+#include <string.h>
+#include <inttypes.h>
+
+class MirfSpiDriver {
+public:
+    virtual ~MirfSpiDriver() {}
+    virtual uint8_t transfer(uint8_t data) = 0;
+    virtual void begin() = 0;
+    virtual void end() = 0;
+};
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef host_SPI_h
+#define host_SPI_h
+
+// Nothing on the host talks SPI; see Mirf.h.
+
+#endif
@@ -0,0 +1,270 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+volatile uint8_t SREG;
+volatile uint8_t PORTB, PORTC, PORTD, PORTE, PORTF;
+volatile uint8_t DDRB, DDRC, DDRD, DDRE, DDRF;
+volatile uint8_t PINB, PINC, PIND, PINE, PINF;
+volatile uint8_t SMCR, MCUSR, PRR0, PRR1;
+volatile uint8_t ADCSRA, ADCSRB, ADMUX, DIDR0;
+volatile uint16_t ADC;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+volatile uint16_t ICR1, TCNT1, OCR1A, OCR1B, OCR1C;
+volatile uint8_t TCCR4A, TCCR4B, TIMSK4, TCNT4, OCR4A;
+host_eecr_t EECR;
+volatile uint8_t EEDR;
+volatile uint16_t EEAR;
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+host_pins_t host_pins;
+
+// time ----------------------------------------------------------------------
+static bool virtual_time_ = false;
+static unsigned long long virtual_now_us_ = 0;
+static bool eeprom_busy_ = false;
+static unsigned long long eeprom_done_us_ = 0;
+
+static unsigned long long _host_now_us()
+{
+    if (virtual_time_) {
+        return virtual_now_us_;
+    }
+
+    static unsigned long long start = 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    unsigned long long now = (unsigned long long)ts.tv_sec * 1000000ULL +
+        ts.tv_nsec / 1000;
+    if (!start) {
+        start = now;
+    }
+    return now - start;
+}
+
+void host_use_virtual_time(bool on)
+{
+    virtual_time_ = on;
+    virtual_now_us_ = 0;
+    eeprom_busy_ = false;
+}
+
+void host_advance_micros(unsigned long us)
+{
+    unsigned long long end = virtual_now_us_ + us;
+    // each write finished on the way lets EE_READY start the next
+    host_eeprom_interrupt();
+    while (eeprom_busy_ && eeprom_done_us_ <= end) {
+        virtual_now_us_ = eeprom_done_us_;
+        eeprom_busy_ = false;
+        host_eeprom_interrupt();
+    }
+    virtual_now_us_ = end;
+}
+
+unsigned long millis()
+{
+    return (unsigned long)(_host_now_us() / 1000);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)_host_now_us();
+}
+
+void delay(unsigned long ms)
+{
+    if (virtual_time_) {
+        virtual_now_us_ += ms * 1000ULL;
+    } else {
+        usleep(ms * 1000);
+    }
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    if (virtual_time_) {
+        virtual_now_us_ += us;
+    } else {
+        usleep(us);
+    }
+}
+
+// pins ----------------------------------------------------------------------
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    host_pins.digital_out[pin & 31] = val;
+}
+
+int digitalRead(uint8_t pin)
+{
+    return host_pins.digital_in[pin & 31];
+}
+
+int analogRead(uint8_t pin)
+{
+    return host_pins.analog_in[pin & 31];
+}
+
+void analogWrite(uint8_t pin, int val)
+{
+    host_pins.analog_out[pin & 31] = val;
+    host_pins.analog_writes++;
+}
+
+// serial --------------------------------------------------------------------
+void HardwareSerial::begin(unsigned long baud)
+{
+}
+
+void HardwareSerial::end()
+{
+}
+
+void HardwareSerial::attach(int fd)
+{
+    fd_ = fd;
+}
+
+int HardwareSerial::available()
+{
+    if (fd_ < 0) {
+        return 0;
+    }
+    struct pollfd pfd = { fd_, POLLIN, 0 };
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN) ? 1 : 0;
+}
+
+int HardwareSerial::read()
+{
+    unsigned char byte;
+    if (fd_ < 0 || ::read(fd_, &byte, 1) != 1) {
+        return -1;
+    }
+    return byte;
+}
+
+size_t HardwareSerial::write(uint8_t byte)
+{
+    return write(&byte, 1);
+}
+
+size_t HardwareSerial::write(const char *buffer, size_t length)
+{
+    return write((const uint8_t *)buffer, length);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t length)
+{
+    if (fd_ < 0) {
+        return length;
+    }
+    ssize_t written = ::write(fd_, buffer, length);
+    if (written < 0) {
+        return errno == EAGAIN ? 0 : length;
+    }
+    return (size_t)written;
+}
+
+size_t HardwareSerial::print(const char *str)
+{
+    return write(str, strlen(str));
+}
+
+// eeprom --------------------------------------------------------------------
+extern "C" void EE_READY_vect(void) __attribute__((weak));
+
+bool host_eeprom_busy()
+{
+    if (eeprom_busy_ && virtual_now_us_ >= eeprom_done_us_) {
+        eeprom_busy_ = false;
+    }
+    return eeprom_busy_;
+}
+
+// spins out the rest of a write, with interrupts masked
+static void _eeprom_wait()
+{
+    if (host_eeprom_busy()) {
+        virtual_now_us_ = eeprom_done_us_;
+        eeprom_busy_ = false;
+    }
+}
+
+void host_eeprom_interrupt()
+{
+    while (EE_READY_vect && (EECR.bits & _BV(EERIE)) && !host_eeprom_busy()) {
+        EE_READY_vect();
+    }
+}
+
+host_eecr_t::operator uint8_t()
+{
+    if (!host_eeprom_busy()) {
+        return bits;
+    }
+    _eeprom_wait();
+    return bits | _BV(EEPE);
+}
+
+host_eecr_t &host_eecr_t::operator|=(uint8_t value)
+{
+    bits |= value;
+    host_eeprom_interrupt();
+    return *this;
+}
+
+EEPROMClass::EEPROMClass()
+{
+    erase();
+}
+
+void EEPROMClass::erase()
+{
+    memset(cells, 0xff, sizeof(cells));
+    memset(writes, 0, sizeof(writes));
+}
+
+uint8_t EEPROMClass::read(int addr)
+{
+    _eeprom_wait();
+    return cells[addr % HOST_EEPROM_SIZE];
+}
+
+void EEPROMClass::write(int addr, uint8_t value)
+{
+    _eeprom_wait();
+    cells[addr % HOST_EEPROM_SIZE] = value;
+    writes[addr % HOST_EEPROM_SIZE]++;
+    if (virtual_time_) {
+        eeprom_busy_ = true;
+        eeprom_done_us_ = virtual_now_us_ + HOST_EEPROM_WRITE_US;
+    }
+}
+
+void EEPROMClass::update(int addr, uint8_t value)
+{
+    if (read(addr) != value) {
+        write(addr, value);
+    }
+}
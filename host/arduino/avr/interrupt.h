@@ -0,0 +1,12 @@
+// There is nothing to mask on the host; ISR bodies become plain functions
+// that a simulator can call directly.
+
+#ifndef host_avr_interrupt_h
+#define host_avr_interrupt_h
+
+#define cli()       ((void)0)
+#define sei()       ((void)0)
+
+#define ISR(vector) extern "C" void vector(void)
+
+#endif // host_avr_interrupt_h
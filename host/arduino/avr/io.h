@@ -0,0 +1,76 @@
+// Host stand-ins for the ATmega32u4 I/O registers touched by Rxr and Txr.
+// They are plain variables, so pin macros like RED_LED_ON() still compile
+// and can be inspected by tests.
+
+#ifndef host_avr_io_h
+#define host_avr_io_h
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+extern volatile uint8_t SREG;
+
+extern volatile uint8_t PORTB, PORTC, PORTD, PORTE, PORTF;
+extern volatile uint8_t DDRB, DDRC, DDRD, DDRE, DDRF;
+extern volatile uint8_t PINB, PINC, PIND, PINE, PINF;
+
+extern volatile uint8_t SMCR, MCUSR, PRR0, PRR1;
+extern volatile uint8_t ADCSRA, ADCSRB, ADMUX, DIDR0;
+extern volatile uint16_t ADC;
+
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+extern volatile uint16_t ICR1, TCNT1, OCR1A, OCR1B, OCR1C;
+extern volatile uint8_t TCCR4A, TCCR4B, TIMSK4, TCNT4, OCR4A;
+
+// EEPE comes from the host EEPROM (EEPROM.h), which is busy for a while
+// after each write under virtual time. A poll that finds it set stands for
+// the spin that follows: the clock moves on to the end of the write, so a
+// busy-wait on EEPE ends and its cost shows in micros().
+struct host_eecr_t {
+    uint8_t bits;
+
+    operator uint8_t();
+    host_eecr_t &operator|=(uint8_t value);
+    host_eecr_t &operator&=(uint8_t value) { bits &= value; return *this; }
+};
+
+extern host_eecr_t EECR;
+extern volatile uint8_t EEDR;
+extern volatile uint16_t EEAR;
+
+#define SE      0
+#define SM0     1
+#define SM1     2
+#define SM2     3
+
+#define WGM40   0
+#define WGM41   1
+#define CS40    0
+#define CS41    1
+#define CS42    2
+#define OCIE4A  6
+
+#define EERE    0
+#define EEPE    1
+#define EEMPE   2
+#define EERIE   3
+
+#define ADPS0   0
+#define ADPS1   1
+#define ADPS2   2
+#define ADSC    6
+#define ADEN    7
+#define MUX1    1
+#define MUX2    2
+#define MUX3    3
+#define MUX4    4
+#define REFS0   6
+
+#define WGM13   4
+#define CS10    0
+#define CS11    1
+#define CS12    2
+#define TOIE1   0
+
+#endif // host_avr_io_h
@@ -0,0 +1,13 @@
+#ifndef host_avr_pgmspace_h
+#define host_avr_pgmspace_h
+
+#include <stdint.h>
+
+#define PROGMEM
+#define PSTR(s)                 (s)
+#define pgm_read_byte_near(p)   (*(const uint8_t *)(p))
+#define pgm_read_byte(p)        pgm_read_byte_near(p)
+#define pgm_read_word_near(p)   (*(const uint16_t *)(p))
+#define pgm_read_word(p)        pgm_read_word_near(p)
+
+#endif // host_avr_pgmspace_h
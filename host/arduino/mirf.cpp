@@ -0,0 +1,205 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+#include "Mirf.h"
+#include "MirfHardwareSpiDriver.h"
+
+Nrf24l Mirf;
+MirfHardwareSpiDriver MirfHardwareSpi;
+
+Nrf24l::Nrf24l() :
+    PTX(0),
+    cePin(8),
+    csnPin(7),
+    channel(1),
+    payload(16),
+    spi(0),
+    rx_addr_p2(0xc3),
+    en_rxaddr((1 << ERX_P0) | (1 << ERX_P1)),
+    en_aa(0x3f),
+    rf_setup(0),
+    sent(0),
+    received(0),
+    dropped(0),
+    rx_head_(0),
+    rx_count_(0)
+{
+    link.send = 0;
+    link.context = 0;
+    memset(rx_addr, 0, sizeof(rx_addr));
+    memset(tx_addr, 0, sizeof(tx_addr));
+}
+
+void Nrf24l::init()
+{
+}
+
+void Nrf24l::config()
+{
+    flushRx();
+}
+
+void Nrf24l::send(uint8_t *value)
+{
+    sent++;
+    if (link.send) {
+        link.send(link.context, tx_addr, value, payload);
+    }
+}
+
+void Nrf24l::setRADDR(uint8_t *adr)
+{
+    memcpy(rx_addr, adr, mirf_ADDR_LEN);
+}
+
+void Nrf24l::setTADDR(uint8_t *adr)
+{
+    memcpy(tx_addr, adr, mirf_ADDR_LEN);
+}
+
+bool Nrf24l::dataReady()
+{
+    return rx_count_ > 0;
+}
+
+bool Nrf24l::isSending()
+{
+    // transmission completes the moment the link has the payload
+    return false;
+}
+
+bool Nrf24l::rxFifoEmpty()
+{
+    return rx_count_ == 0;
+}
+
+bool Nrf24l::txFifoEmpty()
+{
+    return true;
+}
+
+void Nrf24l::getData(uint8_t *data)
+{
+    if (!rx_count_) {
+        return;
+    }
+    memcpy(data, rx_fifo_[rx_head_], payload);
+    rx_head_ = (rx_head_ + 1) % HOST_MIRF_RX_FIFO;
+    rx_count_--;
+}
+
+uint8_t Nrf24l::getStatus()
+{
+    return rx_count_ ? (1 << RX_DR) : 0;
+}
+
+void Nrf24l::configRegister(uint8_t reg, uint8_t value)
+{
+    writeRegister(reg, &value, 1);
+}
+
+void Nrf24l::readRegister(uint8_t reg, uint8_t *value, uint8_t len)
+{
+    memset(value, 0, len);
+    switch (reg) {
+    case TX_ADDR: {
+        memcpy(value, tx_addr, min((int)len, mirf_ADDR_LEN));
+    } break;
+    case RX_ADDR_P1: {
+        memcpy(value, rx_addr, min((int)len, mirf_ADDR_LEN));
+    } break;
+    case RX_ADDR_P2: {
+        value[0] = rx_addr_p2;
+    } break;
+    case EN_RXADDR: {
+        value[0] = en_rxaddr;
+    } break;
+    case EN_AA: {
+        value[0] = en_aa;
+    } break;
+    case RF_SETUP: {
+        value[0] = rf_setup;
+    } break;
+    case RF_CH: {
+        value[0] = channel;
+    } break;
+    }
+}
+
+void Nrf24l::writeRegister(uint8_t reg, uint8_t *value, uint8_t len)
+{
+    switch (reg) {
+    case TX_ADDR: {
+        memcpy(tx_addr, value, min((int)len, mirf_ADDR_LEN));
+    } break;
+    case RX_ADDR_P1: {
+        memcpy(rx_addr, value, min((int)len, mirf_ADDR_LEN));
+    } break;
+    case RX_ADDR_P2: {
+        rx_addr_p2 = value[0];
+    } break;
+    case EN_RXADDR: {
+        en_rxaddr = value[0];
+    } break;
+    case EN_AA: {
+        en_aa = value[0];
+    } break;
+    case RF_SETUP: {
+        rf_setup = value[0];
+    } break;
+    case RF_CH: {
+        channel = value[0];
+    } break;
+    }
+}
+
+void Nrf24l::powerUpRx()
+{
+    PTX = 0;
+}
+
+void Nrf24l::powerUpTx()
+{
+    PTX = 1;
+}
+
+void Nrf24l::powerDown()
+{
+}
+
+void Nrf24l::flushRx()
+{
+    rx_head_ = 0;
+    rx_count_ = 0;
+}
+
+bool Nrf24l::host_receive(const uint8_t *data, uint8_t length)
+{
+    if (rx_count_ >= HOST_MIRF_RX_FIFO) {
+        dropped++;
+        return false;
+    }
+    int tail = (rx_head_ + rx_count_) % HOST_MIRF_RX_FIFO;
+    memset(rx_fifo_[tail], 0, HOST_MIRF_PAYLOAD_MAX);
+    memcpy(rx_fifo_[tail], data, min((int)length, HOST_MIRF_PAYLOAD_MAX));
+    rx_count_++;
+    received++;
+    return true;
+}
+
+bool Nrf24l::host_listens(const uint8_t *addr)
+{
+    if (memcmp(addr + 1, rx_addr + 1, mirf_ADDR_LEN - 1)) {
+        return false;
+    }
+    return ((en_rxaddr & (1 << ERX_P1)) && addr[0] == rx_addr[0]) ||
+           ((en_rxaddr & (1 << ERX_P2)) && addr[0] == rx_addr_p2);
+}
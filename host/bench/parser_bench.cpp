@@ -0,0 +1,98 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// Throughput of one unit's serial API with the serial port taken out of the
+// picture: bytes go straight into serial_api_queue_byte() and responses are
+// taken with serial_api_read_response(), as console_run() does.
+//
+//     rxr_parser_bench [count]
+//
+// Host numbers, so compare runs against each other rather than against the
+// 16 MHz AVR.
+
+// the std headers go first; Arduino.h defines min() and max() as macros
+#include <chrono>
+#include <string>
+#include "Arduino.h"
+#include "serial_api.h"
+#include "radio.h"
+#include "unit.h"
+
+typedef std::chrono::steady_clock clock_type;
+
+static const char *commands[] = {
+    "v\n",
+    "c\n",
+    "m\n",
+    "a\n",
+    "#4711 c\n",
+    "h 0123456789abcdef0123456789abcdef\n",
+    "M 16384\n",
+    "A 16\n",
+    "zz\n",
+};
+
+struct Totals {
+    double seconds;
+    size_t in_bytes;
+    size_t out_bytes;
+};
+
+static Totals _run(const char **which, int num_which, long count)
+{
+    Totals totals = { 0, 0, 0 };
+    clock_type::time_point begin = clock_type::now();
+
+    for (long i = 0; i < count; ++i) {
+        for (const char *c = which[i % num_which]; *c; ++c) {
+            serial_api_queue_byte(*c);
+            ++totals.in_bytes;
+        }
+        totals.out_bytes += serial_api_read_response().length;
+
+        // keep radio commands from filling the packet ring
+        if ((i & 0xf) == 0) {
+            radio_run();
+        }
+    }
+
+    totals.seconds = std::chrono::duration<double>(
+        clock_type::now() - begin).count();
+    return totals;
+}
+
+static void _print(const char *name, long count, const Totals &t)
+{
+    printf("%-40s %12.0f %12.0f %12.0f %8.0f\n",
+           name,
+           count / t.seconds,
+           t.in_bytes / t.seconds,
+           t.out_bytes / t.seconds,
+           t.seconds * 1e9 / count);
+}
+
+int main(int argc, char **argv)
+{
+    long count = argc > 1 ? atol(argv[1]) : 200000;
+    const int num_commands = sizeof(commands) / sizeof(commands[0]);
+
+    unit_setup();
+
+    printf("%-40s %12s %12s %12s %8s\n",
+           "command", "cmds/s", "in B/s", "out B/s", "ns/cmd");
+
+    for (int i = 0; i < num_commands; ++i) {
+        std::string name(commands[i], strlen(commands[i]) - 1);
+        _print(name.c_str(), count, _run(&commands[i], 1, count));
+    }
+    _print("(mix)", count, _run(commands, num_commands, count));
+    return 0;
+}
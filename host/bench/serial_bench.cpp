@@ -0,0 +1,114 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// Measures serial API throughput and round-trip latency through the client
+// pipeline at several window sizes. Point it at a unit or at a loopback:
+//
+//     ./rxr_loopback /tmp/rxr &
+//     ./serial_bench /tmp/rxr 5000
+
+#include "lenzhound_client.h"
+#include <algorithm>
+#include <deque>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+typedef lh::Client::clock clock_type;
+
+struct InFlight {
+    clock_type::time_point start;
+    size_t request_bytes;
+    std::future<lh::Reply> reply;
+};
+
+static double _percentile(std::vector<double> &sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = (size_t)(p * (sorted.size() - 1));
+    return sorted[index];
+}
+
+static void _run(lh::Client &client, int window, int count)
+{
+    static const char *commands[] = { "v", "m", "a", "c" };
+    const int num_commands = sizeof(commands) / sizeof(commands[0]);
+
+    client.set_window(window);
+
+    std::deque<InFlight> in_flight;
+    std::vector<double> latencies;
+    latencies.reserve(count);
+    size_t bytes = 0;
+    int errors = 0;
+
+    clock_type::time_point begin = clock_type::now();
+
+    for (int sent = 0, done = 0; done < count;) {
+        if (sent < count && (int)in_flight.size() < window) {
+            InFlight next;
+            next.start = clock_type::now();
+            next.request_bytes = 8; // "#nnnnn c\n", roughly
+            next.reply = client.request(commands[sent % num_commands]);
+            in_flight.push_back(std::move(next));
+            ++sent;
+            continue;
+        }
+
+        InFlight &head = in_flight.front();
+        try {
+            lh::Reply reply = head.reply.get();
+            bytes += head.request_bytes + reply.line.size() + 8;
+        } catch (const lh::ClientError &) {
+            ++errors;
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(
+            clock_type::now() - head.start).count());
+        in_flight.pop_front();
+        ++done;
+    }
+
+    double seconds = std::chrono::duration<double>(
+        clock_type::now() - begin).count();
+    std::sort(latencies.begin(), latencies.end());
+
+    printf("%6d %10.0f %10.0f %9.0f %9.0f %9.0f %6d\n",
+           window,
+           count / seconds,
+           bytes / seconds,
+           _percentile(latencies, 0.5),
+           _percentile(latencies, 0.99),
+           latencies.empty() ? 0 : latencies.back(),
+           errors);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <device> [count]\n", argv[0]);
+        return 1;
+    }
+    int count = argc > 2 ? atoi(argv[2]) : 2000;
+
+    std::unique_ptr<lh::Client> client = lh::Client::open(argv[1]);
+
+    printf("%6s %10s %10s %9s %9s %9s %6s\n",
+           "window", "cmds/s", "bytes/s", "p50 us", "p99 us", "max us",
+           "errors");
+
+    const int windows[] = { 1, 2, 4, 8 };
+    for (size_t i = 0; i < sizeof(windows) / sizeof(windows[0]); ++i) {
+        _run(*client, windows[i], count);
+    }
+    return 0;
+}
@@ -0,0 +1,241 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// Runs the transmitter's state machine (ao_Txr.cpp) on the host QF port
+// against a scripted pot, encoder, buttons and mode switches, faster than
+// real time, and reports the event throughput and how long each state took
+// to handle each signal.
+//
+//     txr_sm_bench [seconds-per-phase]
+//
+// The script calibrates from a cold start, then spends the given simulated
+// time in free run, play back and Z mode. Host numbers, so compare runs
+// against each other rather than against the 16 MHz AVR; qs_latency gives
+// the on-target figures.
+
+// the std headers go first; Arduino.h defines min() and max() as macros
+#include <chrono>
+#include <map>
+#include <string>
+#include "qf_host.h"
+#include "Txr.h"
+#include "Arduino.h"
+#include "bsp.h"
+#include "host_bsp.h"
+#include "settings.h"
+#include "unit.h"
+
+typedef std::chrono::steady_clock clock_type;
+
+#define MODE_FREE           0x40
+#define MODE_Z              0x10
+#define MODE_PLAY_BACK      0x00
+
+struct Phase {
+    const char *name;
+    int mode;
+    bool pot;           // sweep the pot
+    bool encoder;       // turn the encoder
+    bool buttons;       // press the position buttons in turn
+    bool taps;          // tap the encoder button now and then
+};
+
+static const Phase phases[] = {
+    { "free run",  MODE_FREE,      true,  true,  true,  false },
+    { "play back", MODE_PLAY_BACK, false, true,  true,  false },
+    { "z mode",    MODE_Z,         true,  true,  true,  true  },
+};
+
+static const int position_button_bits[] = { 0x40, 0x20, 0x10, 0x02 };
+
+static const char *signal_names[] = {
+    "ENC_DOWN", "ENC_UP", "PLAY_BACK_MODE", "FREE_RUN_MODE", "Z_MODE",
+    "POSITION_BUTTON", "ALIVE", "MAX_PUB", "SEND_TIMEOUT",
+    "POSITION_TIMEOUT", "FLUSH_SETTINGS_TIMEOUT", "SPEED_AND_ACCEL_TIMEOUT",
+    "FLASH_RATE", "CALIBRATION", "DOUBLE_TAP",
+};
+
+struct Stats {
+    unsigned long count;
+    double total_ns;
+    unsigned long max_ns;
+};
+
+static std::map<std::pair<std::string, int>, Stats> stats;
+static unsigned long tick_count;
+static const Phase *phase;
+
+static std::string _state_name(QP::QStateHandler state)
+{
+    const char *name = qf_host_fun_name(state);
+    if (name) {
+        return name;
+    }
+    char buffer[32];
+    sprintf(buffer, "%p", (void *)state);
+    return buffer;
+}
+
+static std::string _signal_name(int sig)
+{
+    int index = sig - Q_USER_SIG;
+    if (index >= 0 &&
+        index < (int)(sizeof(signal_names) / sizeof(signal_names[0]))) {
+        return signal_names[index];
+    }
+    char buffer[16];
+    sprintf(buffer, "sig %d", sig);
+    return buffer;
+}
+
+static void _on_step(qf_host_step_t const *step)
+{
+    Stats &s = stats[std::make_pair(_state_name(step->state), step->sig)];
+    ++s.count;
+    s.total_ns += step->ns;
+    if (step->ns > s.max_ns) {
+        s.max_ns = step->ns;
+    }
+}
+
+static void _set(volatile uint8_t &reg, int bits, bool on)
+{
+    reg = on ? (reg | bits) : (reg & ~bits);
+}
+
+// the inputs for this tick of the current phase
+static void _tick()
+{
+    unsigned long t = tick_count++;
+
+    PIND = phase->mode;
+
+    // sweep end to end in 4 s, then hold for 4 s
+    if (phase->pot) {
+        unsigned long at = t % (BSP_TICKS_PER_SEC * 8);
+        unsigned long sweep = BSP_TICKS_PER_SEC * 4;
+        if (at < sweep) {
+            unsigned long half = sweep / 2;
+            unsigned long x = at < half ? at : sweep - at;
+            host_pins.analog_in[A0 & 31] = (int)(x * 1023 / half);
+        }
+    }
+
+    // a click every 8 ticks for one second in three
+    if (phase->encoder && (t % (BSP_TICKS_PER_SEC * 3)) < BSP_TICKS_PER_SEC &&
+        (t & 7) == 0) {
+        host_bsp.encoder += ENCODER_STEPS_PER_CLICK;
+    }
+
+    // one button every 2 s, held for 100 ms
+    if (phase->buttons) {
+        unsigned long period = BSP_TICKS_PER_SEC * 2;
+        int button = (t / period) % 4;
+        _set(PINF, 0x72, false);
+        _set(PINF, position_button_bits[button],
+             t % period < BSP_TICKS_PER_SEC / 10);
+    }
+
+    // a single tap every 7 s flips the encoder between speed and accel
+    if (phase->taps) {
+        _set(PINF, 0x01, t % (BSP_TICKS_PER_SEC * 7) < BSP_TICKS_PER_SEC / 10);
+    }
+
+    host_bsp_tick();
+}
+
+// from a cold start in calibration mode: mark one end, turn the encoder,
+// mark the other end and wait out the flashing
+static void _tick_calibrate()
+{
+    unsigned long t = tick_count++;
+
+    PIND = MODE_FREE;
+    bool down = (t >= BSP_TICKS_PER_SEC / 2 &&
+                 t < BSP_TICKS_PER_SEC / 2 + 20) ||
+                (t >= BSP_TICKS_PER_SEC * 3 &&
+                 t < BSP_TICKS_PER_SEC * 3 + 20);
+    _set(PINF, 0x01, down);
+    if (t >= BSP_TICKS_PER_SEC && t < BSP_TICKS_PER_SEC * 2) {
+        host_bsp.encoder += ENCODER_STEPS_PER_CLICK;
+    }
+
+    host_bsp_tick();
+}
+
+static double _run(qf_host_tick_t tick, unsigned long ticks,
+                   unsigned long *steps)
+{
+    tick_count = 0;
+    clock_type::time_point begin = clock_type::now();
+    *steps += qf_host_run(ticks, tick, _on_step);
+    return std::chrono::duration<double>(clock_type::now() - begin).count();
+}
+
+static void _report(double simulated, double seconds, unsigned long steps)
+{
+    printf("%.0f simulated seconds in %.3f s (%.0fx), %lu events, "
+           "%.0f events/s\n\n",
+           simulated, seconds, simulated / seconds, steps, steps / seconds);
+
+    printf("%-22s %-24s %10s %10s %10s\n",
+           "state", "signal", "count", "avg ns", "max ns");
+    for (std::map<std::pair<std::string, int>, Stats>::iterator it =
+             stats.begin(); it != stats.end(); ++it) {
+        const Stats &s = it->second;
+        printf("%-22s %-24s %10lu %10.0f %10lu\n",
+               it->first.first.c_str(), _signal_name(it->first.second).c_str(),
+               s.count, s.total_ns / s.count, s.max_ns);
+    }
+
+    bsp_qf_usage_t usage;
+    BSP_get_qf_usage(&usage);
+    printf("\nfewest free: %d of %d queue entries, %d of %d pool blocks\n",
+           usage.queue_min_free, usage.queue_len,
+           usage.pool_min_free, usage.pool_len);
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 60;
+    if (seconds < 1) {
+        seconds = 1;
+    }
+
+    unit_setup();
+    settings_set_start_in_calibration_mode(true);
+    settings_set_calibration_position_1(0);
+    settings_set_calibration_position_2(0);
+
+    qf_host_startup(BSP_TICKS_PER_SEC);
+    unit_start_qf();
+
+    unsigned long steps = 0;
+    double wall = 0;
+    double simulated = 5;
+
+    wall += _run(_tick_calibrate, BSP_TICKS_PER_SEC * 5, &steps);
+    if (settings_get_calibration_position_1() ==
+        settings_get_calibration_position_2()) {
+        fprintf(stderr, "calibration did not take\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(phases) / sizeof(phases[0]); ++i) {
+        phase = &phases[i];
+        wall += _run(_tick, (unsigned long)BSP_TICKS_PER_SEC * seconds,
+                     &steps);
+        simulated += seconds;
+    }
+
+    _report(simulated, wall, steps);
+    return 0;
+}
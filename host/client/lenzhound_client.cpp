@@ -0,0 +1,617 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+#include "lenzhound_client.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace lh {
+
+// keep in sync with both serial_api.cpp files
+static const char REQUEST_ID = '#';
+static const unsigned int MAX_REQUEST_ID = 0xffff;
+static const char SERIAL_LEDS = 'l';
+static const char SERIAL_POT_GET = 'p';
+static const char SERIAL_ENCODER_GET = 'e';
+
+// The unit parses every byte it has before it drains its 128 byte output
+// buffer, so too many commands in flight overflow it (ERR 01).
+static const int DEFAULT_WINDOW = 4;
+static const int DEFAULT_TIMEOUT_MS = 1000;
+static const int READ_POLL_MS = 10;
+
+Reply parse_reply(const std::string &line)
+{
+    Reply reply;
+    reply.request_id = 0;
+    reply.key = 0;
+    reply.ok = false;
+
+    std::string rest = line;
+    if (!rest.empty() && rest[0] == REQUEST_ID) {
+        size_t space = rest.find(' ');
+        if (space != std::string::npos) {
+            reply.request_id =
+                (unsigned int)strtoul(rest.c_str() + 1, 0, 10);
+            rest = rest.substr(space + 1);
+        }
+    }
+    reply.line = rest;
+
+    if (rest.size() >= 2 && rest[1] == '=') {
+        reply.key = rest[0];
+        reply.value = rest.substr(2);
+    } else if (rest.size() == 4 && rest.compare(1, 3, " OK") == 0) {
+        reply.key = rest[0];
+        reply.ok = true;
+    } else if (rest.size() == 4 && rest.compare(0, 3, "OK ") == 0) {
+        reply.key = rest[3];
+        reply.ok = true;
+    } else {
+        reply.value = rest;
+    }
+    return reply;
+}
+
+static bool _is_error(const Reply &reply)
+{
+    return reply.line.compare(0, 4, "ERR ") == 0;
+}
+
+Client::Client(int fd) :
+    fd_(fd),
+    window_(DEFAULT_WINDOW),
+    timeout_(DEFAULT_TIMEOUT_MS),
+    next_id_(1),
+    stopping_(false)
+{
+    if (pipe(wake_)) {
+        throw ClientError(strerror(errno));
+    }
+    reader_ = std::thread(&Client::_read_loop, this);
+}
+
+Client::~Client()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    space_.notify_all();
+    char byte = 0;
+    (void)write(wake_[1], &byte, 1);
+    reader_.join();
+
+    for (std::map<unsigned int, Pending>::iterator it = pending_.begin();
+         it != pending_.end(); ++it) {
+        it->second.promise.set_exception(
+            std::make_exception_ptr(ClientError("client closed")));
+    }
+    close(wake_[0]);
+    close(wake_[1]);
+    close(fd_);
+}
+
+std::unique_ptr<Client> Client::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        throw ClientError(path + ": " + strerror(errno));
+    }
+    if (isatty(fd)) {
+        struct termios tio;
+        tcgetattr(fd, &tio);
+        cfmakeraw(&tio);
+        cfsetspeed(&tio, B57600);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return std::unique_ptr<Client>(new Client(fd));
+}
+
+void Client::set_window(int window)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    window_ = window < 1 ? 1 : window;
+    space_.notify_all();
+}
+
+void Client::set_timeout(std::chrono::milliseconds timeout)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    timeout_ = timeout;
+}
+
+void Client::set_unsolicited_handler(Handler handler)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    unsolicited_ = handler;
+}
+
+int Client::in_flight()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return (int)pending_.size();
+}
+
+unsigned int Client::_next_id()
+{
+    while (pending_.count(next_id_)) {
+        next_id_ = next_id_ % MAX_REQUEST_ID + 1;
+    }
+    unsigned int id = next_id_;
+    next_id_ = next_id_ % MAX_REQUEST_ID + 1;
+    return id;
+}
+
+std::future<Reply> Client::request(const std::string &command)
+{
+    std::future<Reply> result;
+    unsigned int id;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_ && (int)pending_.size() >= window_) {
+            space_.wait(lock);
+        }
+        if (stopping_) {
+            throw ClientError("client closed");
+        }
+        id = _next_id();
+        Pending &pending = pending_[id];
+        pending.deadline = clock::now() + timeout_;
+        result = pending.promise.get_future();
+    }
+
+    char prefix[16];
+    snprintf(prefix, sizeof(prefix), "%c%u ", REQUEST_ID, id);
+    std::string out = prefix + command + "\n";
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    size_t written = 0;
+    while (written < out.size()) {
+        ssize_t n = write(fd_, out.data() + written, out.size() - written);
+        if (n < 0 && errno != EINTR && errno != EAGAIN) {
+            std::lock_guard<std::mutex> pending_lock(mutex_);
+            std::map<unsigned int, Pending>::iterator it = pending_.find(id);
+            if (it != pending_.end()) {
+                it->second.promise.set_exception(std::make_exception_ptr(
+                    ClientError(std::string("write: ") + strerror(errno))));
+                pending_.erase(it);
+                space_.notify_all();
+            }
+            break;
+        }
+        if (n > 0) {
+            written += n;
+        }
+    }
+    return result;
+}
+
+void Client::_read_loop()
+{
+    std::string line;
+    char buffer[256];
+
+    for (;;) {
+        struct pollfd pfds[2] = {
+            { fd_, POLLIN, 0 },
+            { wake_[0], POLLIN, 0 },
+        };
+        poll(pfds, 2, READ_POLL_MS);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                return;
+            }
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            ssize_t n = read(fd_, buffer, sizeof(buffer));
+            for (ssize_t i = 0; i < n; ++i) {
+                if (buffer[i] == '\n') {
+                    _dispatch(line);
+                    line.clear();
+                } else if (buffer[i] != '\r') {
+                    line += buffer[i];
+                }
+            }
+        }
+
+        _expire(clock::now());
+    }
+}
+
+void Client::_dispatch(const std::string &line)
+{
+    Reply reply = parse_reply(line);
+    Handler handler;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<unsigned int, Pending>::iterator it =
+            pending_.find(reply.request_id);
+
+        if (reply.request_id && it != pending_.end()) {
+            if (_is_error(reply)) {
+                it->second.promise.set_exception(
+                    std::make_exception_ptr(ClientError(reply.line)));
+            } else {
+                it->second.promise.set_value(reply);
+            }
+            pending_.erase(it);
+            space_.notify_all();
+            return;
+        }
+        if (reply.key) {
+            logged_[reply.key] = reply.value;
+        }
+        handler = unsolicited_;
+    }
+    if (handler) {
+        handler(reply);
+    }
+}
+
+void Client::_expire(clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<unsigned int, Pending>::iterator it = pending_.begin();
+    while (it != pending_.end()) {
+        if (it->second.deadline <= now) {
+            it->second.promise.set_exception(
+                std::make_exception_ptr(ClientError("timed out")));
+            pending_.erase(it++);
+            space_.notify_all();
+        } else {
+            ++it;
+        }
+    }
+}
+
+long Client::_logged(char key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<char, std::string>::iterator it = logged_.find(key);
+    if (it == logged_.end()) {
+        throw ClientError(std::string("nothing logged for ") + key);
+    }
+    return strtol(it->second.c_str(), 0, 10);
+}
+
+// accessors -------------------------------------------------------------------
+
+static std::string _command(char key)
+{
+    return std::string(1, key);
+}
+
+static std::string _command(char key, long long value)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%c %lld", key, value);
+    return buffer;
+}
+
+static std::string _command(char key, const std::string &value)
+{
+    return std::string(1, key) + " " + value;
+}
+
+static std::string _as_string(std::future<Reply> reply)
+{
+    return reply.get().value;
+}
+
+static long _as_long(std::future<Reply> reply)
+{
+    return strtol(reply.get().value.c_str(), 0, 10);
+}
+
+static unsigned long _as_ulong(std::future<Reply> reply)
+{
+    return strtoul(reply.get().value.c_str(), 0, 10);
+}
+
+static void _as_ok(std::future<Reply> reply)
+{
+    Reply r = reply.get();
+    if (!r.ok) {
+        throw ClientError("expected OK, got: " + r.line);
+    }
+}
+
+template <typename T>
+static std::future<T> _then(std::future<Reply> reply,
+                            T (*convert)(std::future<Reply>))
+{
+    return std::async(std::launch::deferred, convert, std::move(reply));
+}
+
+static int _as_int(std::future<Reply> reply)
+{
+    return (int)_as_long(std::move(reply));
+}
+
+static unsigned int _as_uint(std::future<Reply> reply)
+{
+    return (unsigned int)_as_ulong(std::move(reply));
+}
+
+std::future<std::string> Client::echo(const std::string &text)
+{
+    return _then(request(_command('h', text)), _as_string);
+}
+
+std::future<std::string> Client::version()
+{
+    return _then(request(_command('v')), _as_string);
+}
+
+std::future<int> Client::role()
+{
+    return _then(request(_command('r')), _as_int);
+}
+
+std::future<std::string> Client::remote_version()
+{
+    return _then(request(_command('w')), _as_string);
+}
+
+std::future<int> Client::remote_role()
+{
+    return _then(request(_command('s')), _as_int);
+}
+
+std::future<int> Client::preset_index()
+{
+    return _then(request(_command('q')), _as_int);
+}
+
+std::future<void> Client::set_preset_index(int index)
+{
+    return _then(request(_command('Q', index)), _as_ok);
+}
+
+std::future<unsigned long> Client::id()
+{
+    return _then(request(_command('i')), _as_ulong);
+}
+
+std::future<void> Client::set_id(unsigned long id)
+{
+    return _then(request(_command('I', (long long)id)), _as_ok);
+}
+
+std::future<std::string> Client::name()
+{
+    return _then(request(_command('n')), _as_string);
+}
+
+std::future<void> Client::set_name(const std::string &name)
+{
+    return _then(request(_command('N', name)), _as_ok);
+}
+
+std::future<int> Client::channel()
+{
+    return _then(request(_command('c')), _as_int);
+}
+
+std::future<void> Client::set_channel(int channel)
+{
+    return _then(request(_command('C', channel)), _as_ok);
+}
+
+std::future<int> Client::remote_channel()
+{
+    return _then(request(_command('d')), _as_int);
+}
+
+std::future<void> Client::set_remote_channel(int channel)
+{
+    return _then(request(_command('D', channel)), _as_ok);
+}
+
+std::future<int> Client::start_state()
+{
+    return _then(request(_command('t')), _as_int);
+}
+
+std::future<void> Client::set_start_state(int state)
+{
+    return _then(request(_command('T', state)), _as_ok);
+}
+
+std::future<unsigned int> Client::max_speed()
+{
+    return _then(request(_command('m')), _as_uint);
+}
+
+std::future<void> Client::set_max_speed(unsigned int speed)
+{
+    return _then(request(_command('M', speed)), _as_ok);
+}
+
+std::future<int> Client::accel()
+{
+    return _then(request(_command('a')), _as_int);
+}
+
+std::future<void> Client::set_accel(int accel)
+{
+    return _then(request(_command('A', accel)), _as_ok);
+}
+
+long Client::pot()
+{
+    return _logged(SERIAL_POT_GET);
+}
+
+long Client::encoder()
+{
+    return _logged(SERIAL_ENCODER_GET);
+}
+
+long Client::leds()
+{
+    return _logged(SERIAL_LEDS);
+}
+
+std::future<void> Client::save_config()
+{
+    return _then(request(_command('u')), _as_ok);
+}
+
+std::future<void> Client::reload_config()
+{
+    return _then(request(_command('x')), _as_ok);
+}
+
+std::future<long> Client::target_position()
+{
+    return _then(request(_command('o')), _as_long);
+}
+
+std::future<void> Client::set_target_position(long position)
+{
+    return _then(request(_command('O', position)), _as_ok);
+}
+
+std::future<std::string> Client::eeprom_export(int start)
+{
+    return _then(request(_command('g', start)), _as_string);
+}
+
+std::future<void> Client::eeprom_import(int start, const std::string &hex)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "G %d %d ", start, (int)hex.size() / 2);
+    return _then(request(buffer + hex), _as_ok);
+}
+
+void Client::debug_fail_assert()
+{
+    // the unit resets instead of answering, so don't wait on it
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    (void)write(fd_, "B\n", 2);
+}
+
+std::future<std::string> Client::debug_string()
+{
+    return _then(request(_command('b')), _as_string);
+}
+
+std::future<void> Client::factory_reset()
+{
+    return _then(request(_command('Y')), _as_ok);
+}
+
+std::future<std::string> Client::eeprom_stats()
+{
+    return _then(request(_command('k')), _as_string);
+}
+
+std::future<unsigned long> Client::eeprom_block_writes(int block)
+{
+    return _then(request(_command('k', block)), _as_ulong);
+}
+
+std::future<void> Client::reset_eeprom_stats()
+{
+    return _then(request(_command('K')), _as_ok);
+}
+
+std::future<std::string> Client::pot_filter()
+{
+    return _then(request(_command('f')), _as_string);
+}
+
+std::future<void> Client::set_pot_filter(int min_alpha, int beta,
+                                         int dead_band)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%d %d %d", min_alpha, beta, dead_band);
+    return _then(request(_command('F', std::string(buffer))), _as_ok);
+}
+
+std::future<long> Client::idle_permille()
+{
+    return _then(request(_command('z')), _as_long);
+}
+
+std::future<std::string> Client::qf_usage()
+{
+    return _then(request(_command('j')), _as_string);
+}
+
+std::future<std::string> Client::take()
+{
+    return _then(request(_command('y')), _as_string);
+}
+
+std::future<void> Client::set_take(int mode)
+{
+    return _then(request(_command('R', mode)), _as_ok);
+}
+
+std::future<std::string> Client::take_export(int start)
+{
+    return _then(request(_command('E', start)), _as_string);
+}
+
+std::future<void> Client::take_import(int start, const std::string &hex)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "L %d %d ", start, (int)hex.size() / 2);
+    return _then(request(buffer + hex), _as_ok);
+}
+
+std::future<unsigned int> Client::move_time(int position)
+{
+    return _then(request(_command('P', position)), _as_uint);
+}
+
+std::future<void> Client::set_move_time(int position, unsigned int ms)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%d %u", position, ms);
+    return _then(request(_command('P', std::string(buffer))), _as_ok);
+}
+
+std::future<int> Client::axis_target(int axis)
+{
+    return _then(request(_command('W', axis)), _as_int);
+}
+
+std::future<void> Client::set_axis_target(int axis, long position)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%d %ld", axis, position);
+    return _then(request(_command('W', std::string(buffer))), _as_ok);
+}
+
+std::future<int> Client::axis()
+{
+    return _then(request(_command('X')), _as_int);
+}
+
+std::future<void> Client::set_axis(int axis)
+{
+    return _then(request(_command('X', axis)), _as_ok);
+}
+
+} // namespace lh
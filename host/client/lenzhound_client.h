@@ -0,0 +1,175 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// Host-side client for the serial API of both units (Txr/serial_api.h and
+// Rxr/serial_api.h). Every command goes out with a "#<id> " prefix, so up
+// to window() commands can be in flight at once and replies, including the
+// asynchronous ones that come back over the radio, are matched by id.
+// Lines without an id (log_value output, LED events) go to the unsolicited
+// handler.
+//
+// Which unit answers a command locally and which forwards it over the radio
+// differs between Txr and Rxr; the accessors are named after the SERIAL_*
+// command they send.
+
+#ifndef lenzhound_client_h
+#define lenzhound_client_h
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace lh {
+
+struct Reply {
+    unsigned int request_id;    // 0 for unsolicited lines
+    char key;                   // the SERIAL_* key the line is about
+    bool ok;                    // "<key> OK" or "OK <key>"
+    std::string value;          // whatever follows "<key>="
+    std::string line;           // the line without prefix and newline
+};
+
+class ClientError : public std::runtime_error {
+public:
+    explicit ClientError(const std::string &what) : std::runtime_error(what) {}
+};
+
+class Client {
+public:
+    typedef std::chrono::steady_clock clock;
+    typedef std::function<void(const Reply &)> Handler;
+
+    // Takes ownership of an open tty, pty or socket.
+    explicit Client(int fd);
+    ~Client();
+
+    // Opens a serial device (or loopback pty) in raw mode.
+    static std::unique_ptr<Client> open(const std::string &path);
+
+    // Sends a raw command, e.g. "M 16384". Blocks while window() commands
+    // are already in flight.
+    std::future<Reply> request(const std::string &command);
+
+    void set_window(int window);
+    int window() const { return window_; }
+    void set_timeout(std::chrono::milliseconds timeout);
+    void set_unsolicited_handler(Handler handler);
+
+    int in_flight();
+
+    // SERIAL_* accessors -----------------------------------------------------
+    std::future<std::string> echo(const std::string &text);
+    std::future<std::string> version();
+    std::future<int> role();
+    std::future<std::string> remote_version();
+    std::future<int> remote_role();
+    std::future<int> preset_index();
+    std::future<void> set_preset_index(int index);
+    std::future<unsigned long> id();
+    std::future<void> set_id(unsigned long id);
+    std::future<std::string> name();
+    std::future<void> set_name(const std::string &name);
+    std::future<int> channel();
+    std::future<void> set_channel(int channel);
+    std::future<int> remote_channel();
+    std::future<void> set_remote_channel(int channel);
+    std::future<int> start_state();
+    std::future<void> set_start_state(int state);
+    std::future<unsigned int> max_speed();
+    std::future<void> set_max_speed(unsigned int speed);
+    std::future<int> accel();
+    std::future<void> set_accel(int accel);
+    // The pot, encoder and LED keys are never asked for; the transmitter
+    // logs them as they change. These return the last logged value and throw
+    // if the unit hasn't logged one yet.
+    long pot();
+    long encoder();
+    long leds();
+    std::future<void> save_config();
+    std::future<void> reload_config();
+    std::future<long> target_position();
+    std::future<void> set_target_position(long position);
+    std::future<std::string> eeprom_export(int start);
+    std::future<void> eeprom_import(int start, const std::string &hex);
+    void debug_fail_assert();
+    std::future<std::string> debug_string();
+    std::future<void> factory_reset();
+    // "<written> <skipped> <us>" since boot or the last reset
+    std::future<std::string> eeprom_stats();
+    std::future<unsigned long> eeprom_block_writes(int block);
+    std::future<void> reset_eeprom_stats();
+    // "<min alpha> <beta> <dead band>", see Txr/pot_filter.h
+    std::future<std::string> pot_filter();
+    std::future<void> set_pot_filter(int min_alpha, int beta, int dead_band);
+    // share of the time asleep since the last call, in 1/1000ths
+    std::future<long> idle_permille();
+    // "<queue len> <queue min free> <pool len> <pool min free>", the event
+    // storage QP has had left at its lowest
+    std::future<std::string> qf_usage();
+    // "<mode> <samples> <bytes> <buffer bytes>", see Txr/take.h
+    std::future<std::string> take();
+    // 0 stop, 1 record, 2 cue, 3 play
+    std::future<void> set_take(int mode);
+    std::future<std::string> take_export(int start);
+    std::future<void> take_import(int start, const std::string &hex);
+    // how long the move to a saved position takes, in ms; 0 is untimed
+    std::future<unsigned int> move_time(int position);
+    std::future<void> set_move_time(int position, unsigned int ms);
+    // where an axis other than the knob's is sent, in steps; -32768 holds
+    // it where it is. See RADIO_AXES in Txr/radio.h.
+    std::future<int> axis_target(int axis);
+    std::future<void> set_axis_target(int axis, long position);
+    // receiver only: which axis it answers to
+    std::future<int> axis();
+    std::future<void> set_axis(int axis);
+
+private:
+    struct Pending {
+        std::promise<Reply> promise;
+        clock::time_point deadline;
+    };
+
+    Client(const Client &);
+    Client &operator=(const Client &);
+
+    void _read_loop();
+    void _dispatch(const std::string &line);
+    void _expire(clock::time_point now);
+    unsigned int _next_id();
+    long _logged(char key);
+
+    int fd_;
+    int wake_[2];
+    int window_;
+    std::chrono::milliseconds timeout_;
+    unsigned int next_id_;
+    std::map<unsigned int, Pending> pending_;
+    std::map<char, std::string> logged_;
+    Handler unsolicited_;
+    std::mutex mutex_;
+    std::mutex write_mutex_;
+    std::condition_variable space_;
+    bool stopping_;
+    std::thread reader_;
+};
+
+Reply parse_reply(const std::string &line);
+
+} // namespace lh
+
+#endif // lenzhound_client_h
@@ -0,0 +1,23 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+#include "Arduino.h"
+#include "eeprom_assert.h"
+
+// On the target a failed assert writes the debug string and jumps to the
+// reset vector. On the host we'd rather stop right where it happened.
+void eeprom_assert(bool condition, int code)
+{
+    if (!condition) {
+        fprintf(stderr, "eeprom_assert failed: ERR: %d\n", code);
+        abort();
+    }
+}
@@ -0,0 +1,21 @@
+#include "unit.h"
+#include "controller.h"
+#include "radio.h"
+#include "settings.h"
+#include "power.h"
+
+void unit_setup()
+{
+    settings_init();
+    controller_init();
+    long motor_position, target_position;
+    if (settings_take_position(&motor_position, &target_position)) {
+        controller_initialize_position(motor_position);
+        controller_move_to_position(target_position);
+    }
+    radio_init();
+    controller_set_accel(settings_get_accel());
+    controller_set_speed(settings_get_max_speed());
+    controller_set_mode(settings_get_mode());
+    power_init();
+}
@@ -0,0 +1,19 @@
+#include "qf_host.h"
+#include "Txr.h"
+#include "host_bsp.h"
+#include "unit.h"
+
+static QEvt const *txrQueueSto[TXR_QUEUE_LEN];
+static QSubscrList subscrSto[MAX_PUB_SIG];
+
+static QF_MPOOL_EL(PositionButtonEvt) smlPoolSto[SMALL_POOL_LEN];
+
+void unit_start_qf()
+{
+    qf_host_set_idle(host_bsp_idle);
+
+    QF::init();
+    QF::poolInit(smlPoolSto, sizeof(smlPoolSto), sizeof(smlPoolSto[0]));
+    QF::psInit(subscrSto, Q_DIM(subscrSto));
+    AO_Txr->start(1U, txrQueueSto, Q_DIM(txrQueueSto), (void *)0, 0U);
+}
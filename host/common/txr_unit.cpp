@@ -0,0 +1,7 @@
+#include "unit.h"
+#include "bsp.h"
+
+void unit_setup()
+{
+    BSP_init();
+}
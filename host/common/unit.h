@@ -0,0 +1,11 @@
+#ifndef unit_h
+#define unit_h
+
+// Brings up the unit the way its setup() would, minus the hardware.
+void unit_setup();
+
+// Transmitter only: the rest of its setup(), the framework and AO_Txr, for
+// the builds that run the state machine on the host QF port.
+void unit_start_qf();
+
+#endif // unit_h
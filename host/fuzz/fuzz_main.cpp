@@ -0,0 +1,123 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// Stand-in for libFuzzer's driver where the toolchain has none (gcc):
+//
+//     rxr_serial_fuzz [-n runs] [-s seed] [file...]
+//
+// Files are replayed as they are, e.g. a crash input saved by libFuzzer.
+// Without files it runs generated inputs: commands from the protocol spliced
+// with request id prefixes, overlong lines, stray newlines and random bytes.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static const char *fragments[] = {
+    "h", "v", "r", "w", "s", "q", "Q", "i", "I", "n", "N", "c", "C", "d", "D",
+    "t", "T", "m", "M", "a", "A", "p", "e", "l", "u", "x", "o", "O", "g", "G",
+    "b", "Y", "_",
+    " ", " 0", " 1", " -1", " 65535", " 65536", " 2147483647", " -2147483648",
+    " 899", " 900", " 16", " 17", " 00ff7e", " zz", " hello",
+    "#", "#1 ", "#65535 ", "#65536 ", "#0 ", "# ", "#12",
+    "\n", "\n", "\n", "\\", "\0",
+};
+
+static unsigned long _next(unsigned long &state)
+{
+    // xorshift, so runs repeat for a given seed on any libc
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+static std::string _generate(unsigned long &state)
+{
+    const int num_fragments = sizeof(fragments) / sizeof(fragments[0]);
+    std::string input;
+    int pieces = 1 + _next(state) % 64;
+
+    for (int i = 0; i < pieces; ++i) {
+        switch (_next(state) % 8) {
+        case 0: {
+            // something longer than the in buffer
+            input.append(100 + _next(state) % 200, 'a' + _next(state) % 26);
+        } break;
+        case 1: {
+            input += (char)_next(state);
+        } break;
+        default: {
+            const char *fragment = fragments[_next(state) % num_fragments];
+            input.append(fragment, *fragment ? strlen(fragment) : 1);
+        } break;
+        }
+    }
+    return input;
+}
+
+static bool _run_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    std::vector<uint8_t> data;
+    int c;
+    while ((c = fgetc(f)) != EOF) {
+        data.push_back((uint8_t)c);
+    }
+    fclose(f);
+
+    LLVMFuzzerTestOneInput(data.empty() ? 0 : &data[0], data.size());
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    long runs = 100000;
+    unsigned long seed = 1;
+    int files = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            runs = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            seed = strtoul(argv[++i], 0, 0);
+        } else {
+            if (!_run_file(argv[i])) {
+                return 1;
+            }
+            ++files;
+        }
+    }
+
+    if (files) {
+        printf("%d inputs replayed\n", files);
+        return 0;
+    }
+
+    unsigned long state = seed ? seed : 1;
+    size_t bytes = 0;
+    for (long run = 0; run < runs; ++run) {
+        std::string input = _generate(state);
+        LLVMFuzzerTestOneInput((const uint8_t *)input.data(), input.size());
+        bytes += input.size();
+    }
+    printf("%ld runs, %lu bytes, seed %lu\n", runs, (unsigned long)bytes, seed);
+    return 0;
+}
@@ -0,0 +1,82 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// libFuzzer-style target for one unit's serial API. Input bytes are fed to
+// serial_api_queue_byte() in chunks, the way console_run() sees them arrive
+// over USB, and the response buffer is drained between chunks. Build it with
+// -fsanitize=address so overruns of the in/out buffers trap; the checks
+// below catch the ones that stay inside serial_api_state.
+
+#include "Arduino.h"
+#include "serial_api.h"
+#include "radio.h"
+#include "unit.h"
+
+extern serial_api_state_t serial_api_state;
+
+// 'B' is SERIAL_DEBUG_FAIL_ASSERT on the transmitter, which
+// resets the unit on purpose
+const char FUZZ_FAIL_ASSERT = 'B';
+
+const size_t FUZZ_CHUNK = 64;
+
+static void _check(bool condition, const char *what)
+{
+    if (!condition) {
+        fprintf(stderr, "serial_api_fuzz: %s\n", what);
+        abort();
+    }
+}
+
+static void _drain()
+{
+    serial_api_response_t response = serial_api_read_response();
+
+    _check(response.length >= 0 &&
+           response.length <= SERIAL_API_OUT_BUFFER_SIZE,
+           "response longer than the out buffer");
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool initialized = false;
+    if (!initialized) {
+        unit_setup();
+        initialized = true;
+    }
+
+    // every input starts from an empty line
+    serial_api_queue_byte('\n');
+    _drain();
+
+    for (size_t i = 0; i < size; ++i) {
+        char byte = (char)data[i];
+        serial_api_queue_byte(byte == FUZZ_FAIL_ASSERT ? SERIAL_IGNORE : byte);
+
+        _check(serial_api_state.in_index >= 0 &&
+               serial_api_state.in_index <= SERIAL_API_IN_BUFFER_SIZE,
+               "in_index out of range");
+        _check(serial_api_state.out_index >= 0 &&
+               serial_api_state.out_index <= SERIAL_API_OUT_BUFFER_SIZE,
+               "out_index out of range");
+
+        if ((i + 1) % FUZZ_CHUNK == 0) {
+            _drain();
+            radio_run();
+        }
+    }
+
+    _drain();
+    radio_run();
+    return 0;
+}
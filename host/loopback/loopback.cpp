@@ -0,0 +1,89 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// Serves one unit's serial API on a pseudo-terminal. The real console_run()
+// and radio_run() of the unit are pumped exactly as the firmware main loop
+// does, so whatever opens the printed /dev/pts path sees the same protocol
+// as a unit on /dev/ttyACM0.
+//
+//     rxr_loopback [link-path]
+//
+// If link-path is given, a symlink to the pty is created there.
+
+#include "Arduino.h"
+#include "unit.h"
+#include "console.h"
+#include "radio.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t running = 1;
+
+static void _stop(int)
+{
+    running = 0;
+}
+
+int main(int argc, char **argv)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) || unlockpt(master)) {
+        perror("posix_openpt");
+        return 1;
+    }
+
+    // hold the slave open in raw mode so the line discipline never echoes
+    // responses back to us and clients coming and going don't hang us up
+    const char *slave_name = ptsname(master);
+    int slave = open(slave_name, O_RDWR | O_NOCTTY);
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    const char *link_path = argc > 1 ? argv[1] : 0;
+    if (link_path) {
+        unlink(link_path);
+        if (symlink(slave_name, link_path)) {
+            perror("symlink");
+            return 1;
+        }
+    }
+
+    signal(SIGINT, _stop);
+    signal(SIGTERM, _stop);
+
+    Serial.attach(master);
+    unit_setup();
+
+    printf("%s\n", slave_name);
+    fflush(stdout);
+
+    while (running) {
+        struct pollfd pfd = { master, POLLIN, 0 };
+        poll(&pfd, 1, 1);
+
+        console_run();
+        radio_run();
+    }
+
+    if (link_path) {
+        unlink(link_path);
+    }
+    close(slave);
+    close(master);
+    return 0;
+}
@@ -0,0 +1,57 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// Host port of the QF "vanilla" kernel. The kernel itself is the one in
+// libraries/qp/qp.cpp; this replaces the Arduino port's loop() and Timer4
+// with a simulated clock so the transmitter's state machine runs on Linux,
+// faster than real time and the same way every run.
+
+#ifndef qf_host_h
+#define qf_host_h
+
+#include <qp_port.h>     // found through -I, so it can include_next the AVR one
+
+// one run-to-completion step
+struct qf_host_step_t {
+    QP::QActive *active;
+    QP::QSignal sig;
+    QP::QStateHandler state;    // the active state when the event arrived
+    unsigned long ns;           // wall time spent in dispatch()
+};
+
+typedef void (*qf_host_tick_t)();
+typedef void (*qf_host_idle_t)();
+typedef void (*qf_host_step_hook_t)(qf_host_step_t const *step);
+
+// Switches the Arduino shim to virtual time and calls QF::onStartup(). The
+// clock will tick ticks_per_sec times a simulated second.
+void qf_host_startup(unsigned int ticks_per_sec);
+
+// The port's QF::onIdle() calls idle, the part of the firmware's onIdle()
+// that isn't sleeping.
+void qf_host_set_idle(qf_host_idle_t idle);
+
+// Dispatches one event to the highest priority active object with one
+// waiting, as a pass of the vanilla QF::run() loop does. False when every
+// queue is empty.
+bool qf_host_step(qf_host_step_t *step);
+
+// Runs ticks simulated clock ticks. Each one advances virtual time by a
+// tick, calls tick (the stand-in for the Timer4 ISR), runs every ready event
+// to completion, passing each step to on_step when it is set, and then calls
+// QF::onIdle() once. Returns the number of steps.
+unsigned long qf_host_run(unsigned long ticks, qf_host_tick_t tick,
+                          qf_host_step_hook_t on_step);
+
+// the name a state handler was given with QS_FUN_DICTIONARY(), or 0
+char const *qf_host_fun_name(QP::QStateHandler fun);
+
+#endif // qf_host_h
@@ -0,0 +1,163 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+#include <string.h>
+#include <time.h>
+#include "Arduino.h"
+#include "qf_host.h"
+
+#define QF_HOST_MAX_FUNS    16
+
+struct qf_host_fun_t {
+    QP::QStateHandler fun;
+    char const *name;
+};
+
+struct qf_host_state_t {
+    unsigned long tick_us;
+    qf_host_idle_t idle;
+    qf_host_step_t step;        // filled in by QF::thread_()
+    qf_host_fun_t funs[QF_HOST_MAX_FUNS];
+    int fun_count;
+};
+
+static qf_host_state_t qf_host_state_;
+
+static unsigned long long _now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// the vanilla kernel declares QF::thread_() but never defines
+// it, which makes it the one place outside qp.cpp that is allowed to call
+// QActive::get_(). It does what the body of QF::run() does for one event.
+void QP::QF::thread_(QActive *act)
+{
+    qf_host_step_t *step = &qf_host_state_.step;
+    step->active = act;
+    step->state = act->state();
+
+    QEvt const *e = act->get_();
+    step->sig = e->sig;
+
+    unsigned long long start = _now_ns();
+    act->dispatch(e);
+    step->ns = (unsigned long)(_now_ns() - start);
+
+    gc(e);
+}
+
+// the framework callbacks; the board's part of onIdle() comes through
+// qf_host_set_idle()
+void QP::QF::onStartup(void)
+{
+}
+
+void QP::QF::onCleanup(void)
+{
+}
+
+// the firmware sleeps here; the simulated clock only moves between ticks
+void QP::QF::onIdle(void)
+{
+    if (qf_host_state_.idle) {
+        qf_host_state_.idle();
+    }
+}
+
+void Q_onAssert(char const *const module, int location)
+{
+    fprintf(stderr, "Q_onAssert %s:%d\n", module, location);
+    abort();
+}
+
+void qf_host_set_idle(qf_host_idle_t idle)
+{
+    qf_host_state_.idle = idle;
+}
+
+void qf_host_startup(unsigned int ticks_per_sec)
+{
+    qf_host_state_.tick_us = 1000000UL / ticks_per_sec;
+    host_use_virtual_time(true);
+    QP::QF::onStartup();
+}
+
+bool qf_host_step(qf_host_step_t *step)
+{
+    if (!QF_readySet_.notEmpty()) {
+        return false;
+    }
+
+    uint8_t p = QF_readySet_.findMax();
+    QF_currPrio_ = p;
+    QP::QF::thread_(QP::QF::active_[p]);
+
+    if (step) {
+        *step = qf_host_state_.step;
+    }
+    return true;
+}
+
+unsigned long qf_host_run(unsigned long ticks, qf_host_tick_t tick,
+                          qf_host_step_hook_t on_step)
+{
+    unsigned long steps = 0;
+    qf_host_step_t step;
+
+    for (unsigned long i = 0; i < ticks; ++i) {
+        host_advance_micros(qf_host_state_.tick_us);
+        if (tick) {
+            tick();
+        }
+
+        while (qf_host_step(&step)) {
+            ++steps;
+            if (on_step) {
+                on_step(&step);
+            }
+        }
+
+        QP::QF::onIdle();
+    }
+    return steps;
+}
+
+void qf_host_fun_dictionary(QP::QStateHandler fun, char const *name)
+{
+    if (*name == '&') {
+        ++name;
+    }
+
+    for (int i = 0; i < qf_host_state_.fun_count; ++i) {
+        if (qf_host_state_.funs[i].fun == fun) {
+            qf_host_state_.funs[i].name = name;
+            return;
+        }
+    }
+    if (qf_host_state_.fun_count < QF_HOST_MAX_FUNS) {
+        qf_host_fun_t *entry = &qf_host_state_.funs[qf_host_state_.fun_count++];
+        entry->fun = fun;
+        entry->name = name;
+    }
+}
+
+char const *qf_host_fun_name(QP::QStateHandler fun)
+{
+    for (int i = 0; i < qf_host_state_.fun_count; ++i) {
+        if (qf_host_state_.funs[i].fun == fun) {
+            return qf_host_state_.funs[i].name;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,28 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// Sits in front of libraries/qp/qp_port.h on the host. The AVR port is used
+// as it is; the only change is that QS_FUN_DICTIONARY(), which is a no-op
+// without Q_SPY, hands the state handlers to the host port so the benchmark
+// can name the states it times.
+
+#ifndef host_qp_port_h
+#define host_qp_port_h
+
+#include_next "qp_port.h"
+
+void qf_host_fun_dictionary(QP::QStateHandler fun, char const *name);
+
+#undef QS_FUN_DICTIONARY
+#define QS_FUN_DICTIONARY(fun_) \
+    qf_host_fun_dictionary((QP::QStateHandler)(fun_), #fun_)
+
+#endif // host_qp_port_h
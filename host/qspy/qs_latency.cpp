@@ -0,0 +1,375 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// Decodes the QS trace of a transmitter built with Q_SPY and prints, per
+// signal, how long events sat in the active object's queue (post to
+// dispatch) and how long the state machine took to handle them (dispatch to
+// the end of the run-to-completion step).
+//
+//     qs_latency /dev/ttyACM0      # until ^C
+//     qs_latency capture.bin       # until end of file
+//
+// Record layouts follow libraries/qp/qp_port.h as configured for the AVR
+// port: 4 byte time stamps and object/function pointers, 2 byte signals and
+// 1 byte queue counters.
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+enum {
+    QS_QEP_INTERN_TRAN          = 5,
+    QS_QEP_TRAN                 = 6,
+    QS_QEP_IGNORED              = 7,
+    QS_QEP_DISPATCH             = 8,
+    QS_QF_ACTIVE_POST_FIFO      = 14,
+    QS_QF_ACTIVE_POST_LIFO      = 15,
+    QS_SIG_DIC                  = 60,
+};
+
+const uint8_t QS_FRAME          = 0x7e;
+const uint8_t QS_ESC            = 0x7d;
+const uint8_t QS_ESC_XOR        = 0x20;
+
+struct Post {
+    uint16_t sig;
+    uint32_t time;
+};
+
+struct Dispatch {
+    bool active;
+    uint16_t sig;
+    uint32_t time;
+};
+
+struct Stats {
+    unsigned long count;
+    double wait_total;
+    uint32_t wait_max;
+    unsigned long waits;
+    double rtc_total;
+    uint32_t rtc_max;
+    int min_free;
+};
+
+struct Decoder {
+    std::map<uint16_t, std::string> sig_names;
+    std::map<uint32_t, std::deque<Post> > queues;
+    std::map<uint32_t, Dispatch> dispatches;
+    std::map<uint16_t, Stats> stats;
+    unsigned long frames;
+    unsigned long bad_frames;
+    unsigned long lost_frames;
+    bool have_seq;
+    uint8_t seq;
+};
+
+// Reads little-endian fields off a record, remembering if it ran short.
+struct Reader {
+    const uint8_t *at;
+    const uint8_t *end;
+    bool ok;
+
+    uint32_t u(int size)
+    {
+        uint32_t value = 0;
+        if (end - at < size) {
+            ok = false;
+            return 0;
+        }
+        for (int i = 0; i < size; ++i) {
+            value |= (uint32_t)at[i] << (8 * i);
+        }
+        at += size;
+        return value;
+    }
+    uint32_t time() { return u(4); }
+    uint16_t sig() { return (uint16_t)u(2); }
+    uint32_t obj() { return u(4); }
+    uint32_t fun() { return u(4); }
+    uint8_t eqc() { return (uint8_t)u(1); }
+    uint8_t u8() { return (uint8_t)u(1); }
+
+    std::string str()
+    {
+        std::string value;
+        while (at < end && *at) {
+            value += (char)*at++;
+        }
+        if (at == end) {
+            ok = false;
+        } else {
+            ++at;
+        }
+        return value;
+    }
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void _stop(int)
+{
+    running = 0;
+}
+
+static Stats &_stats(Decoder &d, uint16_t sig)
+{
+    std::map<uint16_t, Stats>::iterator it = d.stats.find(sig);
+    if (it == d.stats.end()) {
+        Stats fresh;
+        memset(&fresh, 0, sizeof(fresh));
+        fresh.min_free = -1;
+        it = d.stats.insert(std::make_pair(sig, fresh)).first;
+    }
+    return it->second;
+}
+
+static void _post(Decoder &d, Reader &r, bool lifo)
+{
+    Post post;
+    post.time = r.time();
+    if (!lifo) {
+        r.obj();                                            // sender
+    }
+    post.sig = r.sig();
+    uint32_t ao = r.obj();
+    r.u8();                                                 // pool id
+    r.u8();                                                 // ref count
+    int free = r.eqc();
+    r.eqc();                                                // min free
+    if (!r.ok) {
+        return;
+    }
+
+    Stats &stats = _stats(d, post.sig);
+    if (stats.min_free < 0 || free < stats.min_free) {
+        stats.min_free = free;
+    }
+
+    std::deque<Post> &queue = d.queues[ao];
+    if (lifo) {
+        queue.push_front(post);
+    } else {
+        queue.push_back(post);
+    }
+}
+
+static void _dispatch(Decoder &d, Reader &r)
+{
+    uint32_t time = r.time();
+    uint16_t sig = r.sig();
+    uint32_t ao = r.obj();
+    r.fun();
+    if (!r.ok) {
+        return;
+    }
+
+    Stats &stats = _stats(d, sig);
+    ++stats.count;
+
+    // the oldest post of this signal is the one being dispatched; anything
+    // queued ahead of it was lost to an overrun of the ring
+    std::deque<Post> &queue = d.queues[ao];
+    for (size_t i = 0; i < queue.size(); ++i) {
+        if (queue[i].sig == sig) {
+            uint32_t wait = time - queue[i].time;
+            stats.wait_total += wait;
+            stats.waits++;
+            if (wait > stats.wait_max) {
+                stats.wait_max = wait;
+            }
+            queue.erase(queue.begin(), queue.begin() + i + 1);
+            break;
+        }
+    }
+
+    Dispatch &dispatch = d.dispatches[ao];
+    dispatch.active = true;
+    dispatch.sig = sig;
+    dispatch.time = time;
+}
+
+static void _done(Decoder &d, Reader &r)
+{
+    uint32_t time = r.time();
+    uint16_t sig = r.sig();
+    uint32_t ao = r.obj();
+    if (!r.ok) {
+        return;
+    }
+
+    Dispatch &dispatch = d.dispatches[ao];
+    if (dispatch.active && dispatch.sig == sig) {
+        Stats &stats = _stats(d, sig);
+        uint32_t rtc = time - dispatch.time;
+        stats.rtc_total += rtc;
+        if (rtc > stats.rtc_max) {
+            stats.rtc_max = rtc;
+        }
+    }
+    dispatch.active = false;
+}
+
+static void _record(Decoder &d, const uint8_t *data, size_t length)
+{
+    // seq, record id, payload, checksum
+    if (length < 3) {
+        ++d.bad_frames;
+        return;
+    }
+
+    uint8_t sum = 0;
+    for (size_t i = 0; i < length; ++i) {
+        sum += data[i];
+    }
+    if (sum != 0xff) {
+        ++d.bad_frames;
+        return;
+    }
+
+    ++d.frames;
+    uint8_t seq = data[0];
+    if (d.have_seq && seq != (uint8_t)(d.seq + 1)) {
+        d.lost_frames += (uint8_t)(seq - d.seq - 1);
+        // pairing across a gap would only produce nonsense
+        d.queues.clear();
+        d.dispatches.clear();
+    }
+    d.have_seq = true;
+    d.seq = seq;
+
+    Reader r = { data + 2, data + length - 1, true };
+
+    switch (data[1]) {
+    case (QS_QF_ACTIVE_POST_FIFO): {
+        _post(d, r, false);
+    } break;
+    case (QS_QF_ACTIVE_POST_LIFO): {
+        _post(d, r, true);
+    } break;
+    case (QS_QEP_DISPATCH): {
+        _dispatch(d, r);
+    } break;
+    case (QS_QEP_TRAN):
+    case (QS_QEP_INTERN_TRAN):
+    case (QS_QEP_IGNORED): {
+        _done(d, r);
+    } break;
+    case (QS_SIG_DIC): {
+        uint16_t sig = r.sig();
+        r.obj();
+        std::string name = r.str();
+        if (r.ok) {
+            d.sig_names[sig] = name;
+        }
+    } break;
+    }
+}
+
+static void _report(Decoder &d)
+{
+    printf("%-28s %8s %10s %10s %10s %10s %6s\n",
+           "signal", "count", "wait avg", "wait max", "rtc avg", "rtc max",
+           "free");
+
+    for (std::map<uint16_t, Stats>::iterator it = d.stats.begin();
+         it != d.stats.end(); ++it) {
+        const Stats &s = it->second;
+        std::string name = d.sig_names[it->first];
+        if (name.empty()) {
+            char buffer[16];
+            sprintf(buffer, "sig %u", it->first);
+            name = buffer;
+        }
+
+        printf("%-28s %8lu %10.0f %10lu %10.0f %10lu %6d\n",
+               name.c_str(),
+               s.count,
+               s.waits ? s.wait_total / s.waits : 0.0,
+               (unsigned long)s.wait_max,
+               s.count ? s.rtc_total / s.count : 0.0,
+               (unsigned long)s.rtc_max,
+               s.min_free);
+    }
+
+    printf("\n%lu records, %lu bad, %lu lost (times in us, free is the "
+           "fewest free queue entries seen on post)\n",
+           d.frames, d.bad_frames, d.lost_frames);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <device|file|->\n", argv[0]);
+        return 1;
+    }
+
+    int fd = strcmp(argv[1], "-") ? open(argv[1], O_RDONLY | O_NOCTTY) : 0;
+    if (fd < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    struct termios tio;
+    if (isatty(fd) && !tcgetattr(fd, &tio)) {
+        cfmakeraw(&tio);
+        cfsetspeed(&tio, B57600);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    signal(SIGINT, _stop);
+    signal(SIGTERM, _stop);
+
+    Decoder decoder;
+    decoder.frames = 0;
+    decoder.bad_frames = 0;
+    decoder.lost_frames = 0;
+    decoder.have_seq = false;
+    decoder.seq = 0;
+
+    std::vector<uint8_t> frame;
+    bool escaped = false;
+    uint8_t buffer[256];
+
+    while (running) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0) {
+            break;
+        }
+
+        for (ssize_t i = 0; i < n; ++i) {
+            uint8_t b = buffer[i];
+            if (b == QS_FRAME) {
+                if (!frame.empty()) {
+                    _record(decoder, &frame[0], frame.size());
+                }
+                frame.clear();
+                escaped = false;
+            } else if (b == QS_ESC) {
+                escaped = true;
+            } else {
+                frame.push_back(escaped ? (uint8_t)(b ^ QS_ESC_XOR) : b);
+                escaped = false;
+            }
+        }
+    }
+
+    _report(decoder);
+    return 0;
+}
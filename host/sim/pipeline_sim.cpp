@@ -0,0 +1,789 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// The whole focus pipeline in one process: the transmitter's state machine
+// on the host QF port, a radio link with loss, latency and jitter, and the
+// receiver's radio and motor controller, all on one simulated clock. An
+// operator script snaps the pot between positions and pulls it back and
+// forth, and the report gives the latency from the pot to the receiver's
+// target, to its first step and to the last move of the target (which a
+// lost packet drags out), the settling time, and how closely the
+// motor tracks the pot during the pulls. Last, one pull is recorded as a
+// take and replayed, and the replay is held up against the original, two
+// saved positions are given durations and timed against them, a lens with
+// a curved focus scale is calibrated through points along its throw, and
+// the receiver is moved to a second axis, where the pot should leave it be
+// and the targets sent over serial should move it.
+//
+//     pipeline_sim [-n snaps] [-c cycles] [-l loss %] [-d latency us]
+//                  [-j jitter us] [-s seed]
+//
+// Both units run their real firmware sources (see sim.h). What isn't real
+// is the timing around them, which follows the target: Timer4 ticks the
+// transmitter 256 times a second, each tick starts a burst of 16 ADC
+// conversions, and QF::onIdle() polls the console and the radio after each
+// tick and over and over while the radio is busy; Timer1 runs the
+// controller 6000 times a second while the motor is awake, and a parked
+// receiver polls the radio once per Timer0 overflow.
+// The receiver sends nothing over the air, so the link only carries
+// transmitter packets; the acknowledged ones are retransmitted as the nRF24
+// would, the broadcast isn't.
+
+// the std headers go first; Arduino.h defines min() and max() as macros,
+// hence the (std::min)() below
+#include <math.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include "qf_host.h"
+#include "Arduino.h"
+#include "sim.h"
+
+#define TXR_TICKS_PER_SEC       256         // BSP_TICKS_PER_SEC
+#define TXR_POLL_NS             104000ULL   // onIdle() with the radio busy
+#define TXR_ADC_BURST           16          // POT_OVERSAMPLE
+// how long the transmitter is awake for each, from the cycles at 16 MHz,
+// for the share of the time asleep that 'z' reports
+#define TXR_TICK_NS             100000ULL   // Timer4 and the events it posts
+#define TXR_POLL_PASS_NS        40000ULL    // console_run() and radio_run()
+#define TXR_SHORT_WAKE_NS       10000ULL    // ADC or USB frame, back to sleep
+#define RXR_ISR_PER_SEC         6000ULL     // ISR_CALLS_PER_SECOND
+#define RXR_LOOP_NS             50000ULL
+#define RXR_PARKED_LOOP_NS      1024000ULL
+#define SAMPLE_NS               1000000ULL
+#define NS_PER_SEC              1000000000ULL
+
+#define FREE_SWITCH             0x40        // FREESWITCH_ON(), on PIND
+#define CAL_BUTTON              0x01        // CALBUTTON_ON(), on PINF
+#define CAL_MULTIPLIER          8           // steps per click in free mode
+#define ENCODER_STEPS           4           // ENCODER_STEPS_PER_CLICK
+#define POT_MAX                 1023
+#define RANGE                   4000        // steps from one end to the other
+#define WARM_UP_NS              (NS_PER_SEC * 2)
+#define REST_NS                 (NS_PER_SEC * 3 / 10)
+#define SNAP_TIMEOUT_NS         (NS_PER_SEC * 10)
+#define SNAP_MAX_FINAL_MS       100         // well short of a keep-alive
+#define RADIO_RETRANSMITS       3           // SETUP_RETR's reset value
+#define RADIO_RETRANSMIT_NS     250000ULL   // and its delay
+#define TAKE_MAX_RMS            10          // steps, replay against recording
+#define TIMED_MAX_ERROR_MS      20          // arrival against the duration
+#define CAL_MARKS               8           // calibration segments
+#define CAL_MAX_ERROR           30          // steps off a lens mark
+#define CAL_CLOSE_MARK          4           // CALIBRATION_MIN_SPAN, in pot
+#define OTHER_AXIS              1           // not the knob's
+
+struct Packet {
+    unsigned long long due_ns;
+    uint8_t addr[mirf_ADDR_LEN];
+    uint8_t data[HOST_MIRF_PAYLOAD_MAX];
+    uint8_t length;
+};
+
+struct Link {
+    double loss;                // 0..1
+    unsigned long latency_us;
+    unsigned long jitter_us;
+    std::deque<Packet> air;
+    unsigned long long last_due_ns;
+    unsigned long sent;
+    unsigned long lost;
+    unsigned long overflowed;   // arrived with the receiver's FIFO full
+};
+
+struct Sweep {
+    double hz;
+    int amplitude;              // steps either side of the middle
+};
+
+static const Sweep sweeps[] = {
+    { 0.25, 1500 },
+    { 0.5, 800 },
+    { 1.0, 400 },
+};
+
+struct TimedMove {
+    int pot;                    // where the saved position is taken
+    int button;                 // PBUTTONS() bit
+    unsigned int ms;
+};
+
+// from the middle to one, then across to the other
+static const TimedMove timed_moves[] = {
+    { POT_MAX / 8, 0x40, 2000 },
+    { POT_MAX * 7 / 8, 0x20, 3000 },
+};
+
+enum { SNAP_RESTING, SNAP_MOVING };
+
+struct Snap {
+    int state;
+    int remaining;
+    unsigned long long t0;
+    long from_motor;
+    long from_target;
+    int dir;
+    unsigned long long command_ns;      // the receiver's target moves
+    unsigned long long step_ns;         // the motor takes its first step
+};
+
+struct Results {
+    std::vector<double> command_ms;
+    std::vector<double> step_ms;
+    std::vector<double> final_ms;       // the target stops moving
+    std::vector<double> settle_ms;
+    std::vector<double> error_steps;
+    unsigned long timeouts;
+};
+
+struct Sim {
+    unsigned long long now_ns;
+    unsigned long long clock_us;        // what micros() has been moved to
+    Link link;
+    unsigned long rng;
+    int pot;
+    long last_motor;
+    long last_target;
+    unsigned long long last_move_ns;
+    unsigned long long last_target_ns;
+    Snap snap;
+    Results results;
+};
+
+static Sim sim;
+
+static unsigned long _random()
+{
+    sim.rng ^= sim.rng << 13;
+    sim.rng ^= sim.rng >> 7;
+    sim.rng ^= sim.rng << 17;
+    return sim.rng;
+}
+
+static long _ideal(int pot)
+{
+    return (long)pot * RANGE / POT_MAX;
+}
+
+// the curved lens: its marks bunch up toward the far end of the pot
+static long _lens(int pot)
+{
+    return (long)((long long)RANGE * pot * pot / ((long long)POT_MAX * POT_MAX));
+}
+
+static void _set_pot(int pot)
+{
+    sim.pot = (std::max)(0, (std::min)(POT_MAX, pot));
+    host_pins.analog_in[A0 & 31] = sim.pot;
+}
+
+static void _link_send(void *context, const uint8_t *addr,
+                       const uint8_t *payload, uint8_t length)
+{
+    Link *link = (Link *)context;
+
+    // an acknowledged packet is sent again until the ACK comes back or the
+    // retransmits run out; the broadcast goes out once
+    int retransmits = txr::sim_radio().en_aa ? RADIO_RETRANSMITS : 0;
+    int attempt = 0;
+    for (;;) {
+        ++link->sent;
+        if ((_random() % 1000000) >= link->loss * 1000000) {
+            break;
+        }
+        ++link->lost;
+        if (attempt++ == retransmits) {
+            return;
+        }
+    }
+
+    // the nRF24 delivers in order, however late
+    Packet packet;
+    packet.due_ns = sim.now_ns + attempt * RADIO_RETRANSMIT_NS +
+        link->latency_us * 1000ULL +
+        (_random() % (link->jitter_us + 1)) * 1000ULL;
+    packet.due_ns = (std::max)(packet.due_ns, link->last_due_ns);
+    link->last_due_ns = packet.due_ns;
+    packet.length = (std::min)((int)length, HOST_MIRF_PAYLOAD_MAX);
+    memcpy(packet.data, payload, packet.length);
+    memcpy(packet.addr, addr, mirf_ADDR_LEN);
+    link->air.push_back(packet);
+}
+
+static void _deliver()
+{
+    while (!sim.link.air.empty() && sim.link.air.front().due_ns <= sim.now_ns) {
+        Packet &packet = sim.link.air.front();
+        if (!rxr::sim_radio().host_listens(packet.addr)) {
+            // for another axis
+        } else if (!rxr::sim_radio().host_receive(packet.data, packet.length)) {
+            ++sim.link.overflowed;
+        }
+        sim.link.air.pop_front();
+    }
+}
+
+// after anything the receiver does: note the first move of the target and
+// of the motor after a snap
+static void _observe()
+{
+    long motor = rxr::sim_motor_position();
+    long target = rxr::sim_target_position();
+    if (motor != sim.last_motor) {
+        sim.last_motor = motor;
+        sim.last_move_ns = sim.now_ns;
+    }
+    if (target != sim.last_target) {
+        sim.last_target = target;
+        sim.last_target_ns = sim.now_ns;
+    }
+
+    Snap &snap = sim.snap;
+    if (snap.state != SNAP_MOVING) {
+        return;
+    }
+    if (!snap.command_ns && (target - snap.from_target) * snap.dir > 0) {
+        snap.command_ns = sim.now_ns;
+    }
+    if (!snap.step_ns && (motor - snap.from_motor) * snap.dir > 0) {
+        snap.step_ns = sim.now_ns;
+    }
+}
+
+static void _snap_sample()
+{
+    Snap &snap = sim.snap;
+    Results &results = sim.results;
+    bool resting = sim.last_motor == sim.last_target &&
+        sim.now_ns - sim.last_move_ns >= REST_NS &&
+        sim.now_ns - sim.last_target_ns >= REST_NS;
+
+    if (snap.state == SNAP_MOVING) {
+        if (sim.now_ns - snap.t0 > SNAP_TIMEOUT_NS) {
+            ++results.timeouts;
+        } else if (!snap.step_ns || !resting) {
+            return;
+        } else {
+            results.command_ms.push_back((snap.command_ns - snap.t0) / 1e6);
+            results.step_ms.push_back((snap.step_ns - snap.t0) / 1e6);
+            results.final_ms.push_back((sim.last_target_ns - snap.t0) / 1e6);
+            results.settle_ms.push_back((sim.last_move_ns - snap.t0) / 1e6);
+            results.error_steps.push_back(
+                fabs((double)(sim.last_motor - _ideal(sim.pot))));
+        }
+        snap.state = SNAP_RESTING;
+        --snap.remaining;
+        return;
+    }
+
+    if (!resting || snap.remaining <= 0) {
+        return;
+    }
+
+    // somewhere at least a tenth of the range away
+    int pot;
+    do {
+        pot = _random() % (POT_MAX + 1);
+    } while (abs(pot - sim.pot) < POT_MAX / 10);
+
+    snap.state = SNAP_MOVING;
+    snap.t0 = sim.now_ns;
+    snap.from_motor = sim.last_motor;
+    snap.from_target = sim.last_target;
+    snap.dir = _ideal(pot) > sim.last_motor ? 1 : -1;
+    snap.command_ns = 0;
+    snap.step_ns = 0;
+    _set_pot(pot);
+}
+
+typedef void (*sample_t)(unsigned long long since_ns);
+
+// Runs both units until done() says so or until_ns, calling sample once a
+// simulated millisecond.
+static void _run(unsigned long long until_ns, bool (*done)(), sample_t sample)
+{
+    static unsigned long long next_tick_ns = 0;
+    static unsigned long long next_wake_ns = 0;
+    static unsigned long long txr_awake_ns = 0;   // still to be awake for
+    static unsigned long long txr_asleep_ns = 0;  // not yet handed over
+    static unsigned long long next_loop_ns = 0;
+    static unsigned long long isr_epoch_ns = 0;
+    static unsigned long long isr_count = 0;
+    static bool parked = false;
+
+    unsigned long long start_ns = sim.now_ns;
+    unsigned long long next_sample_ns = sim.now_ns;
+
+    while (sim.now_ns < until_ns && !(done && done())) {
+        unsigned long long next_isr_ns =
+            isr_epoch_ns + isr_count * NS_PER_SEC / RXR_ISR_PER_SEC;
+        unsigned long long next = (std::min)((std::min)(next_tick_ns, next_wake_ns),
+            (std::min)((std::min)(next_loop_ns, next_sample_ns),
+                     parked ? ~0ULL : next_isr_ns));
+        if (!sim.link.air.empty()) {
+            next = (std::min)(next, sim.link.air.front().due_ns);
+        }
+
+        unsigned long long step_ns = next - sim.now_ns;
+        unsigned long long awake_ns = (std::min)(step_ns, txr_awake_ns);
+        txr_awake_ns -= awake_ns;
+        txr_asleep_ns += step_ns - awake_ns;
+        txr::sim_sleep((unsigned long)(txr_asleep_ns / 1000));
+        txr_asleep_ns %= 1000;
+
+        sim.now_ns = next;
+        unsigned long long now_us = sim.now_ns / 1000;
+        host_advance_micros(now_us - sim.clock_us);
+        sim.clock_us = now_us;
+
+        _deliver();
+
+        if (!parked && sim.now_ns >= next_isr_ns) {
+            rxr::sim_isr();
+            ++isr_count;
+            _observe();
+        }
+        if (sim.now_ns >= next_loop_ns) {
+            rxr::sim_loop();
+            _observe();
+            // park_control_isr(): Timer1 stops while the motor sleeps and
+            // restarts from zero when it wakes
+            if (rxr::sim_asleep()) {
+                parked = true;
+            } else if (parked) {
+                parked = false;
+                isr_epoch_ns = sim.now_ns;
+                isr_count = 1;
+            }
+            next_loop_ns = sim.now_ns +
+                (parked ? RXR_PARKED_LOOP_NS : RXR_LOOP_NS);
+        }
+        if (sim.now_ns >= next_tick_ns) {
+            txr::sim_tick();
+            txr::sim_idle();
+            txr_awake_ns += TXR_TICK_NS + TXR_POLL_PASS_NS +
+                            TXR_ADC_BURST * TXR_SHORT_WAKE_NS;
+            next_tick_ns += NS_PER_SEC / TXR_TICKS_PER_SEC;
+        }
+        if (sim.now_ns >= next_wake_ns) {
+            // packets queued behind the one on the air keep onIdle() awake
+            if (txr::sim_radio_busy()) {
+                txr::sim_idle();
+                txr_awake_ns += TXR_POLL_NS;
+            }
+            next_wake_ns += TXR_POLL_NS;
+        }
+        if (sim.now_ns >= next_sample_ns) {
+            txr_awake_ns += TXR_SHORT_WAKE_NS;     // USB start of frame
+            if (sample) {
+                sample(sim.now_ns - start_ns);
+            }
+            next_sample_ns += SAMPLE_NS;
+        }
+    }
+}
+
+static bool _snaps_done()
+{
+    return sim.snap.remaining <= 0 && sim.snap.state == SNAP_RESTING;
+}
+
+static void _snap_sample_hook(unsigned long long)
+{
+    _snap_sample();
+}
+
+// one sweep's motor and pot samples, a millisecond apart
+static std::vector<long> sweep_motor;
+static std::vector<long> sweep_ideal;
+static const Sweep *sweep;
+
+static void _sweep_sample(unsigned long long since_ns)
+{
+    double t = since_ns / 1e9;
+    int middle = POT_MAX / 2;
+    int amplitude = sweep->amplitude * POT_MAX / RANGE;
+    _set_pot(middle + (int)lround(amplitude * sin(2 * M_PI * sweep->hz * t)));
+
+    sweep_motor.push_back(rxr::sim_motor_position());
+    sweep_ideal.push_back(_ideal(sim.pot));
+}
+
+static void _take_sample(unsigned long long)
+{
+    sweep_motor.push_back(rxr::sim_motor_position());
+}
+
+// the encoder as it has to be, in free mode, to put the motor at position;
+// calibration starts counting from wherever it is, 0 here
+static void _set_encoder(long position)
+{
+    txr::sim_set_encoder(lround((double)position / CAL_MULTIPLIER) *
+                         ENCODER_STEPS);
+}
+
+static void _press(int button)
+{
+    PINF = button;
+    _run(sim.now_ns + NS_PER_SEC / 20, 0, 0);
+    PINF = 0;
+    _run(sim.now_ns + NS_PER_SEC / 20, 0, 0);
+}
+
+// furthest the motor comes to rest from the lens marks between the ends
+static double _mark_error()
+{
+    double worst = 0;
+    for (int i = 1; i < 2 * CAL_MARKS; ++i) {
+        _set_pot(i * POT_MAX / (2 * CAL_MARKS));
+        _run(sim.now_ns + NS_PER_SEC * 2, 0, 0);
+        worst = (std::max)(worst,
+            fabs((double)(rxr::sim_motor_position() - _lens(sim.pot))));
+    }
+    return worst;
+}
+
+// false, after saying why, when the transmitter refuses the command
+static bool _command(const char *line, char *reply, int size)
+{
+    txr::sim_command(line, reply, size);
+    if (strstr(reply, "ERR")) {
+        fprintf(stderr, "\"%s\": %s", line, reply);
+        return false;
+    }
+    return true;
+}
+
+// the same, for the receiver
+static bool _rxr_command(const char *line, char *reply, int size)
+{
+    rxr::sim_command(line, reply, size);
+    if (strstr(reply, "ERR")) {
+        fprintf(stderr, "\"%s\": %s", line, reply);
+        return false;
+    }
+    return true;
+}
+
+static double _percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)ceil(p * values.size()) - 1;
+    return values[(std::min)(index, values.size() - 1)];
+}
+
+static void _print_distribution(const char *name, const std::vector<double> &v)
+{
+    printf("  %-24s %9.2f %9.2f %9.2f %9.2f\n", name,
+           _percentile(v, 0.5), _percentile(v, 0.9), _percentile(v, 0.99),
+           _percentile(v, 1.0));
+}
+
+// the delay, in samples, that best lines out up with in, and the rms error
+// left at that delay
+static void _best_lag(const std::vector<long> &out, const std::vector<long> &in,
+                      size_t from, int *lag, double *rms)
+{
+    *lag = 0;
+    *rms = 1e30;
+    for (int d = 0; d <= 500 && (size_t)d < from; ++d) {
+        double sum = 0;
+        for (size_t i = from; i < out.size(); ++i) {
+            double e = out[i] - in[i - d];
+            sum += e * e;
+        }
+        double r = sqrt(sum / (out.size() - from));
+        if (r < *rms) {
+            *rms = r;
+            *lag = d;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int snaps = 50;
+    int cycles = 4;
+    sim.link.loss = 0;
+    sim.link.latency_us = 1000;
+    sim.link.jitter_us = 200;
+    sim.rng = 0x2545f491;
+
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && !strcmp(argv[i], "-n")) {
+            snaps = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-c")) {
+            cycles = (std::max)(2, atoi(argv[++i]));
+        } else if (i + 1 < argc && !strcmp(argv[i], "-l")) {
+            sim.link.loss = atof(argv[++i]) / 100;
+        } else if (i + 1 < argc && !strcmp(argv[i], "-d")) {
+            sim.link.latency_us = strtoul(argv[++i], 0, 0);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-j")) {
+            sim.link.jitter_us = strtoul(argv[++i], 0, 0);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-s")) {
+            sim.rng = strtoul(argv[++i], 0, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-n snaps] [-c cycles] [-l loss %%] "
+                    "[-d latency us] [-j jitter us] [-s seed]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!sim.rng) {
+        sim.rng = 1;
+    }
+
+    qf_host_startup(TXR_TICKS_PER_SEC);
+    PIND = FREE_SWITCH;                 // the pot drives the motor directly
+    _set_pot(POT_MAX / 2);
+    txr::sim_start(0, RANGE);
+    rxr::sim_start();
+    txr::sim_radio().link.send = _link_send;
+    txr::sim_radio().link.context = &sim.link;
+
+    _run(WARM_UP_NS, 0, 0);
+    char reply[64];
+    _command("z", reply, sizeof(reply));    // start counting from here
+
+    sim.snap.state = SNAP_RESTING;
+    sim.snap.remaining = snaps;
+    _run(~0ULL, _snaps_done, _snap_sample_hook);
+
+    printf("link: %.1f%% loss, %lu us latency, %lu us jitter\n\n",
+           sim.link.loss * 100, sim.link.latency_us, sim.link.jitter_us);
+
+    Results &results = sim.results;
+    printf("%d snaps (ms)               %9s %9s %9s %9s\n",
+           snaps, "p50", "p90", "p99", "max");
+    _print_distribution("pot to target", results.command_ms);
+    _print_distribution("pot to first step", results.step_ms);
+    _print_distribution("pot to final target", results.final_ms);
+    _print_distribution("pot to settled", results.settle_ms);
+    _print_distribution("settled error (steps)", results.error_steps);
+
+    printf("\n%d cycle pulls (steps)       %9s %9s %9s %9s\n",
+           cycles, "rms", "max", "lag ms", "rms @lag");
+    for (size_t i = 0; i < sizeof(sweeps) / sizeof(sweeps[0]); ++i) {
+        sweep = &sweeps[i];
+        sweep_motor.clear();
+        sweep_ideal.clear();
+        unsigned long long length_ns =
+            (unsigned long long)(cycles * NS_PER_SEC / sweep->hz);
+        _run(sim.now_ns + length_ns, 0, _sweep_sample);
+
+        // leave the first cycle out, it's the motor catching up
+        size_t from = (size_t)(1000 / sweep->hz);
+        double sum = 0;
+        double worst = 0;
+        for (size_t j = from; j < sweep_motor.size(); ++j) {
+            double e = fabs((double)(sweep_motor[j] - sweep_ideal[j]));
+            sum += e * e;
+            worst = (std::max)(worst, e);
+        }
+        int lag;
+        double lag_rms;
+        _best_lag(sweep_motor, sweep_ideal, from, &lag, &lag_rms);
+
+        char name[32];
+        sprintf(name, "%.2f Hz +-%d", sweep->hz, sweep->amplitude);
+        printf("  %-24s %9.1f %9.0f %9d %9.1f\n", name,
+               sqrt(sum / (sweep_motor.size() - from)), worst, lag, lag_rms);
+
+        _set_pot(POT_MAX / 2);
+        _run(sim.now_ns + NS_PER_SEC, 0, 0);
+    }
+
+    int idle = 0;
+    _command("z", reply, sizeof(reply));
+    sscanf(reply, "z=%d", &idle);
+    printf("\ntransmitter asleep %d.%d%% of the snaps and pulls\n",
+           idle / 10, idle % 10);
+
+    // the 0.5 Hz pull again, recorded as a take; then the take replayed in
+    // play-back mode, which should move the motor the same way again
+    bool take_ok = _command("R 1", reply, sizeof(reply));
+    sweep = &sweeps[1];
+    sweep_motor.clear();
+    sweep_ideal.clear();
+    // two cycles, 4 s, inside what the take buffer holds
+    unsigned long long take_ns = (unsigned long long)(2 * NS_PER_SEC / sweep->hz);
+    _run(sim.now_ns + take_ns, 0, _sweep_sample);
+    take_ok = _command("R 0", reply, sizeof(reply)) && take_ok;
+    std::vector<long> recorded = sweep_motor;
+
+    int mode = 0;
+    int samples = 0;
+    int bytes = 0;
+    int buffer_bytes = 0;
+    take_ok = _command("y", reply, sizeof(reply)) && take_ok;
+    sscanf(reply, "y=%d %d %d %d", &mode, &samples, &bytes, &buffer_bytes);
+
+    _set_pot(POT_MAX / 2);
+    PIND = 0;                           // play-back mode
+    _run(sim.now_ns + NS_PER_SEC, 0, 0);
+    take_ok = _command("R 2", reply, sizeof(reply)) && take_ok;
+    _run(sim.now_ns + NS_PER_SEC, 0, 0);
+    sweep_motor.clear();
+    take_ok = _command("R 3", reply, sizeof(reply)) && take_ok;
+    _run(sim.now_ns + take_ns, 0, _take_sample);
+    PIND = FREE_SWITCH;
+
+    int take_lag;
+    double take_rms;
+    _best_lag(sweep_motor, recorded, 100, &take_lag, &take_rms);
+    printf("\ntake: %d samples in %d of %d bytes, %.2f bytes a sample\n",
+           samples, bytes, buffer_bytes, samples ? (double)bytes / samples : 0);
+    printf("  replay against recording: %.1f steps rms at %d ms lag\n",
+           take_rms, take_lag);
+
+    // save the timed positions in free mode, then press them in play-back
+    const int timed_count = sizeof(timed_moves) / sizeof(timed_moves[0]);
+    bool timed_ok = true;
+    for (int i = 0; i < timed_count; ++i) {
+        _set_pot(timed_moves[i].pot);
+        _run(sim.now_ns + NS_PER_SEC * 3 / 2, 0, 0);
+        PINF = timed_moves[i].button;
+        _run(sim.now_ns + NS_PER_SEC / 20, 0, 0);
+        PINF = 0;
+        char line[32];
+        sprintf(line, "P %d %u", i, timed_moves[i].ms);
+        timed_ok = _command(line, reply, sizeof(reply)) && timed_ok;
+    }
+    _set_pot(POT_MAX / 2);
+    _run(sim.now_ns + NS_PER_SEC * 3 / 2, 0, 0);
+    PIND = 0;
+    _run(sim.now_ns + NS_PER_SEC / 2, 0, 0);
+
+    printf("\ntimed moves (ms)            %9s %9s %9s\n",
+           "steps", "asked", "took");
+    for (int i = 0; i < timed_count; ++i) {
+        long from = rxr::sim_motor_position();
+        unsigned long long t0 = sim.now_ns;
+        PINF = timed_moves[i].button;
+        _run(sim.now_ns + NS_PER_SEC / 20, 0, 0);
+        PINF = 0;
+        _run(t0 + timed_moves[i].ms * 1000000ULL + NS_PER_SEC * 3 / 2, 0, 0);
+
+        double took = (sim.last_move_ns - t0) / 1e6;
+        char name[32];
+        sprintf(name, "  position %d", i);
+        printf("%-28s %9ld %9u %9.1f\n", name,
+               labs(rxr::sim_motor_position() - from), timed_moves[i].ms, took);
+        if (fabs(took - timed_moves[i].ms) > TIMED_MAX_ERROR_MS) {
+            timed_ok = false;
+        }
+    }
+    PIND = FREE_SWITCH;
+
+    // the ends alone, as the unit started out, against the ends and the
+    // points in between. Calibration zeroes the motor where it stands, at
+    // the near end here, so both are measured from the same place.
+    double ends_error = _mark_error();
+    _set_pot(0);
+    _run(sim.now_ns + NS_PER_SEC * 3 / 2, 0, 0);
+    _press(CAL_BUTTON);                 // a double tap starts calibrating
+    _press(CAL_BUTTON);
+    _run(sim.now_ns + NS_PER_SEC / 2, 0, 0);
+    _press(CAL_BUTTON);                 // the near end, where the motor is
+    _run(sim.now_ns + NS_PER_SEC * 3 / 2, 0, 0);
+    _set_encoder(_lens(POT_MAX));
+    _run(sim.now_ns + NS_PER_SEC, 0, 0);
+    _press(CAL_BUTTON);                 // the far end, and a second press
+    _press(CAL_BUTTON);                 // for points in between
+    _run(sim.now_ns + NS_PER_SEC * 3 / 2, 0, 0);
+    for (int i = 1; i < CAL_MARKS; ++i) {
+        _set_pot(i * POT_MAX / CAL_MARKS);
+        _set_encoder(_lens(sim.pot));
+        _run(sim.now_ns + NS_PER_SEC / 2, 0, 0);
+        _press(CAL_BUTTON);
+        if (i == CAL_MARKS - 1) {
+            _press(CAL_BUTTON);         // that was the last
+        }
+        _run(sim.now_ns + NS_PER_SEC * 3 / 2, 0, 0);
+        if (i > 1) {
+            continue;
+        }
+        // a second mark as close as points can be to the first, then a
+        // stray one between the two, off the lens, which has to be dropped
+        // rather than replace either and leave the pair too close to build
+        int mark = sim.pot;
+        _set_pot(mark + CAL_CLOSE_MARK);
+        _set_encoder(_lens(sim.pot));
+        _run(sim.now_ns + NS_PER_SEC / 2, 0, 0);
+        _press(CAL_BUTTON);
+        _run(sim.now_ns + NS_PER_SEC * 3 / 2, 0, 0);
+        _set_pot(mark + CAL_CLOSE_MARK / 2);
+        _set_encoder(_lens(sim.pot) + RANGE / 10);
+        _run(sim.now_ns + NS_PER_SEC / 2, 0, 0);
+        _press(CAL_BUTTON);
+        _run(sim.now_ns + NS_PER_SEC * 3 / 2, 0, 0);
+    }
+    double points_error = _mark_error();
+
+    printf("\ncurved lens, steps off the marks   %9s\n", "max");
+    printf("  %-32s %9.0f\n", "ends only", ends_error);
+    char name[32];
+    sprintf(name, "ends and %d between", CAL_MARKS);
+    printf("  %-32s %9.0f\n", name, points_error);
+
+    // the receiver as the second axis: the knob's targets go past it, and
+    // the ones sent for its axis over serial move it
+    bool axis_ok = _rxr_command("X 1", reply, sizeof(reply));
+    _run(sim.now_ns + NS_PER_SEC / 2, 0, 0);
+    long held = rxr::sim_motor_position();
+    _set_pot(held > RANGE / 2 ? 0 : POT_MAX);
+    _run(sim.now_ns + NS_PER_SEC * 2, 0, 0);
+    long drift = labs(rxr::sim_motor_position() - held);
+    long axis_target = held > RANGE / 2 ? RANGE / 4 : RANGE * 3 / 4;
+    char line[32];
+    sprintf(line, "W %d %ld", OTHER_AXIS, axis_target);
+    axis_ok = _command(line, reply, sizeof(reply)) && axis_ok;
+    _run(sim.now_ns + NS_PER_SEC * 3, 0, 0);
+    long axis_error = labs(rxr::sim_motor_position() - axis_target);
+    sprintf(line, "W %d %d", OTHER_AXIS, -32767 - 1);
+    axis_ok = _command(line, reply, sizeof(reply)) && axis_ok;
+    axis_ok = _rxr_command("X 0", reply, sizeof(reply)) && axis_ok;
+
+    printf("\naxis %d, steps                      %9s\n", OTHER_AXIS, "off");
+    printf("  %-32s %9ld\n", "moved by the pot", drift);
+    printf("  %-32s %9ld\n", "from its own target", axis_error);
+
+    printf("\n%lu packets sent, %lu lost on the link, %lu dropped with the "
+           "receiver's FIFO full\n",
+           sim.link.sent, sim.link.lost, sim.link.overflowed);
+
+    if (results.timeouts) {
+        fprintf(stderr, "%lu snaps never settled\n", results.timeouts);
+        return 1;
+    }
+    if (_percentile(results.final_ms, 1.0) > SNAP_MAX_FINAL_MS) {
+        fprintf(stderr, "a snap's last position was lost on the link\n");
+        return 1;
+    }
+    if (!take_ok || take_rms > TAKE_MAX_RMS) {
+        fprintf(stderr, "the take didn't replay\n");
+        return 1;
+    }
+    if (!timed_ok) {
+        fprintf(stderr, "a timed move missed its duration\n");
+        return 1;
+    }
+    if (points_error > CAL_MAX_ERROR) {
+        fprintf(stderr, "the calibration missed the lens marks\n");
+        return 1;
+    }
+    if (!axis_ok || drift || axis_error) {
+        fprintf(stderr, "the second axis didn't keep to its own target\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// The receiver for pipeline_sim, compiled as one unit inside namespace rxr;
+// see txr_sim.cpp.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "Mirf.h"
+#include "MirfHardwareSpiDriver.h"
+#include "nRF24L01.h"
+#include "SPI.h"
+#include "sim.h"
+
+namespace rxr {
+
+Nrf24l Mirf;
+EEPROMClass EEPROM;
+HardwareSerial Serial;
+
+#include "../../Rxr/console.cpp"
+#include "../../Rxr/controller.cpp"
+#include "../../Rxr/eeprom_helpers.cpp"
+#include "../../Rxr/motor.cpp"
+#include "../../Rxr/power.cpp"
+#include "../../Rxr/radio.cpp"
+#include "../../Rxr/serial_api.cpp"
+#include "../../Rxr/settings.cpp"
+#include "../common/eeprom_assert.cpp"
+#include "../common/rxr_unit.cpp"
+
+void sim_start()
+{
+    unit_setup();
+}
+
+void sim_loop()
+{
+    radio_run();
+    console_run();
+    settings_run();
+}
+
+void sim_isr()
+{
+    controller_run();
+}
+
+bool sim_asleep()
+{
+    return controller_is_asleep();
+}
+
+long sim_motor_position()
+{
+    return fixed_to_i32(controller_get_motor_position());
+}
+
+long sim_target_position()
+{
+    return fixed_to_i32(controller_get_target_position());
+}
+
+void sim_command(const char *line, char *reply, int size)
+{
+    for (const char *c = line; *c; ++c) {
+        serial_api_queue_byte(*c);
+    }
+    serial_api_queue_byte('\n');
+
+    serial_api_response_t response = serial_api_read_response();
+    int length = response.length < size ? response.length : size - 1;
+    memcpy(reply, response.buffer, length);
+    reply[length] = 0;
+}
+
+Nrf24l &sim_radio()
+{
+    return Mirf;
+}
+
+} // namespace rxr
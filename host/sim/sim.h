@@ -0,0 +1,49 @@
+#ifndef sim_h
+#define sim_h
+
+#include "Mirf.h"
+
+// both units are built into pipeline_sim, each inside its own
+// namespace (txr_sim.cpp, rxr_sim.cpp) with its own radio, EEPROM and
+// serial port. The clock, pins and registers are shared. This is all the
+// simulator sees of them.
+
+namespace txr {
+
+// setup() with the pot calibrated to [position_1, position_2] and the unit
+// starting out of calibration mode. Call qf_host_startup() first.
+void sim_start(long position_1, long position_2);
+// one Timer4 tick, run to completion
+void sim_tick();
+// what QF::onIdle() does between sleeps: after each tick's events, and
+// over and over while sim_radio_busy()
+void sim_idle();
+bool sim_radio_busy();
+// time the CPU would have spent asleep, for BSP_idle_permille()
+void sim_sleep(unsigned long us);
+// one serial API command, e.g. "R 1", and its reply
+void sim_command(const char *line, char *reply, int size);
+// where BSP_get_encoder() says the encoder is
+void sim_set_encoder(long count);
+Nrf24l &sim_radio();
+
+}
+
+namespace rxr {
+
+void sim_start();
+// one pass of loop(), minus the power monitor
+void sim_loop();
+// the Timer1 ISR
+void sim_isr();
+// loop() parks the ISR while this is true
+bool sim_asleep();
+long sim_motor_position();      // in steps
+long sim_target_position();     // in steps
+// one serial API command, e.g. "X 1", and its reply
+void sim_command(const char *line, char *reply, int size);
+Nrf24l &sim_radio();
+
+}
+
+#endif // sim_h
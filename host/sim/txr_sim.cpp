@@ -0,0 +1,106 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// The transmitter for pipeline_sim, compiled as one unit inside namespace
+// txr. Everything a source file could include from outside the firmware is
+// included first, so the includes inside the namespace are all no-ops.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "qf_host.h"
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "Mirf.h"
+#include "MirfHardwareSpiDriver.h"
+#include "nRF24L01.h"
+#include "SPI.h"
+#include "sim.h"
+
+namespace txr {
+
+Nrf24l Mirf;
+EEPROMClass EEPROM;
+HardwareSerial Serial;
+
+#include "../../Txr/ao_Txr.cpp"
+#include "../../Txr/calibration.cpp"
+#include "../../Txr/console.cpp"
+#include "../../Txr/eeprom_helpers.cpp"
+#include "../../Txr/leds.cpp"
+#include "../../Txr/pot_filter.cpp"
+#include "../../Txr/radio.cpp"
+#include "../../Txr/serial_api.cpp"
+#include "../../Txr/settings.cpp"
+#include "../../Txr/settings_log.cpp"
+#include "../../Txr/take.cpp"
+#include "../common/eeprom_assert.cpp"
+#include "../common/txr_qf.cpp"
+#include "../common/txr_unit.cpp"
+#include "../txr/bsp.cpp"
+#include "../txr/bsp_qf.cpp"
+
+void sim_start(long position_1, long position_2)
+{
+    unit_setup();
+    settings_set_start_in_calibration_mode(false);
+    settings_set_calibration_position_1(position_1);
+    settings_set_calibration_position_2(position_2);
+    unit_start_qf();
+}
+
+void sim_tick()
+{
+    host_bsp_tick();
+    while (qf_host_step(0)) {
+    }
+}
+
+void sim_idle()
+{
+    host_bsp_idle();
+}
+
+bool sim_radio_busy()
+{
+    return radio_busy();
+}
+
+void sim_sleep(unsigned long us)
+{
+    host_bsp.asleep_us += us;
+}
+
+void sim_command(const char *line, char *reply, int size)
+{
+    for (const char *c = line; *c; ++c) {
+        serial_api_queue_byte(*c);
+    }
+    serial_api_queue_byte('\n');
+
+    serial_api_response_t response = serial_api_read_response();
+    int length = response.length < size ? response.length : size - 1;
+    memcpy(reply, response.buffer, length);
+    reply[length] = 0;
+}
+
+void sim_set_encoder(long count)
+{
+    host_bsp.encoder = count;
+}
+
+Nrf24l &sim_radio()
+{
+    return Mirf;
+}
+
+} // namespace txr
@@ -0,0 +1,111 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// Host board support for the transmitter. Inputs come from host_pins and
+// host_bsp so a test or simulator can script the pot, encoder and switches;
+// outputs land in the same places for inspection.
+
+#include "qp_port.h"
+#include "Txr.h"
+#include "Arduino.h"
+#include "bsp.h"
+#include "host_bsp.h"
+#include "radio.h"
+#include "settings.h"
+
+host_bsp_t host_bsp;
+
+void BSP_init(void)
+{
+    Serial.begin(57600);
+
+    eeprom_init();
+    settings_init();
+
+    radio_init();
+}
+
+long BSP_get_encoder()
+{
+    return host_bsp.encoder;
+}
+
+// the pin reads 10 bits; the firmware oversamples to POT_BITS
+int BSP_get_pot()
+{
+    return analogRead(A0) << (POT_BITS - 10);
+}
+
+int BSP_get_mode()
+{
+    int buttonState = MODE_SWITCHES();
+
+    if (buttonState & 0x10) {
+        return Z_MODE;
+    } else if (buttonState & 0x40) {
+        return FREE_MODE;
+    } else {
+        return PLAY_BACK_MODE;
+    }
+}
+
+bool BSP_serial_available()
+{
+    return Serial.available() > 0;
+}
+
+char BSP_serial_read()
+{
+    return Serial.read();
+}
+
+int BSP_serial_write(char* buffer, int length)
+{
+    return Serial.write(buffer, length);
+}
+
+void BSP_assert(bool condition)
+{
+    if (!condition) {
+        fprintf(stderr, "BSP_assert failed\n");
+        abort();
+    }
+}
+
+unsigned long BSP_millis()
+{
+    return millis();
+}
+
+// the host never sleeps, but a simulator can say how long the target would
+// have in host_bsp.asleep_us
+unsigned int BSP_idle_permille()
+{
+    static unsigned long since_us;
+    unsigned long now_us = micros();
+    unsigned long elapsed_ms = (now_us - since_us) / 1000;
+    unsigned long asleep_us = host_bsp.asleep_us;
+    host_bsp.asleep_us = 0;
+    since_us = now_us;
+
+    return elapsed_ms ? (unsigned int)(asleep_us / elapsed_ms) : 0;
+}
+
+#ifndef HOST_QF
+// without the framework (bsp_qf.cpp has the real one) nothing is ever used
+void BSP_get_qf_usage(bsp_qf_usage_t *usage)
+{
+    usage->queue_len = TXR_QUEUE_LEN;
+    usage->queue_min_free = TXR_QUEUE_LEN;
+    usage->pool_len = SMALL_POOL_LEN;
+    usage->pool_min_free = SMALL_POOL_LEN;
+}
+#endif
@@ -0,0 +1,90 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// Host board support for the builds that run ao_Txr.cpp on the host QF port
+// in qp/. The Timer4 ISR becomes host_bsp_tick(), which the port calls once
+// per simulated tick, and QF::onIdle()'s work becomes host_bsp_idle().
+
+#include "qp_port.h"
+#include "Txr.h"
+#include "bsp.h"
+#include "Arduino.h"
+#include "host_bsp.h"
+#include "radio.h"
+#include "console.h"
+
+static int prev_button_state_ = 0;
+static int prev_mode_state_ = -1;    // force signal on startup with -1
+static int prev_position_state_ = 0; // position buttons
+
+void host_bsp_tick()
+{
+    QF::TICK((void *)0);
+
+    int button_state = CALBUTTON_ON();
+
+    if (button_state != prev_button_state_) {
+        if (button_state != 0) {
+            QF::PUBLISH(Q_NEW(QEvt, ENC_DOWN_SIG), (void *)0);
+        } else {
+            QF::PUBLISH(Q_NEW(QEvt, ENC_UP_SIG), (void *)0);
+        }
+        prev_button_state_ = button_state;
+    }
+
+    button_state = MODE_SWITCHES();
+    if (button_state != prev_mode_state_) {
+        if (button_state & 0x10) {
+            QF::PUBLISH(Q_NEW(QEvt, Z_MODE_SIG), (void *)0);
+        } else if (button_state & 0x40) {
+            QF::PUBLISH(Q_NEW(QEvt, FREE_RUN_MODE_SIG), (void *)0);
+        } else {
+            QF::PUBLISH(Q_NEW(QEvt, PLAY_BACK_MODE_SIG), (void *)0);
+        }
+        prev_mode_state_ = button_state;
+    }
+
+    button_state = PBUTTONS();
+    if (button_state != prev_position_state_) {
+        int tempState = button_state ^ prev_position_state_;
+        tempState &= button_state;
+        prev_position_state_ = button_state;
+        if (tempState != 0) {
+            PositionButtonEvt *evt = Q_NEW(PositionButtonEvt,
+                                           POSITION_BUTTON_SIG);
+            if (tempState & 0x40) {
+                evt->ButtonNum = 0;
+            } else if (tempState & 0x20) {
+                evt->ButtonNum = 1;
+            } else if (tempState & 0x10) {
+                evt->ButtonNum = 2;
+            } else if (tempState & 0x02) {
+                evt->ButtonNum = 3;
+            }
+            QF::PUBLISH(evt, (void *)0);
+        }
+    }
+}
+
+// what QF::onIdle() does between sleeps on the target
+void host_bsp_idle()
+{
+    console_run();
+    radio_run();
+}
+
+void BSP_get_qf_usage(bsp_qf_usage_t *usage)
+{
+    usage->queue_len = TXR_QUEUE_LEN;
+    usage->queue_min_free = QF::getQueueMargin(1U);
+    usage->pool_len = SMALL_POOL_LEN;
+    usage->pool_min_free = QF::getPoolMargin(1U);
+}
@@ -0,0 +1,18 @@
+#ifndef host_bsp_h
+#define host_bsp_h
+
+// host only: transmitter inputs that have no Arduino pin equivalent
+struct host_bsp_t {
+    long encoder;
+    unsigned long asleep_us;    // what a simulator says the target slept
+};
+
+extern host_bsp_t host_bsp;
+
+// what the Timer4 ISR does each tick: ticks QF and publishes the button,
+// mode switch and position button edges (bsp_qf.cpp)
+void host_bsp_tick();
+// what QF::onIdle() does before it sleeps: the console and the radio
+void host_bsp_idle();
+
+#endif // host_bsp_h
@@ -0,0 +1,419 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// Runs the transmitter's settings code through simulated shooting days and
+// reports how the EEPROM writes spread over the cells, next to what the same
+// changes would have cost written in place. Every power cycle replays the
+// settings log and checks it against what was written, so this doubles as a
+// test of the log.
+//
+// It runs on virtual time with the EEPROM busy for each byte it programs,
+// as on the part. The power goes at a random point shortly after the last
+// change, and whatever the write queue still holds is lost with it; the
+// last change may be lost, nothing before it. The time each change holds
+// up its caller is reported too: writing one mustn't wait on the EEPROM at
+// all, and a preset switch, which reads, no longer than one byte takes.
+//
+//     eeprom_wear [days] [seed]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "settings.h"
+#include "settings_log.h"
+
+#define CELL_ENDURANCE          100000
+#define HOURS_PER_DAY           10
+#define POWER_CYCLES_PER_DAY    2
+
+// events per hour of use
+#define SPEED_ACCEL_FLUSHES     30
+#define PRESET_SWITCHES         12
+#define SAVED_POSITIONS         20
+
+// the EEPROM has long drained the queue by the next change
+#define EVENT_GAP_US            1000000UL
+// the power goes this soon after the last change, at most: long enough to
+// cut a record partway
+#define POWER_CUT_MAX_US        (HOST_EEPROM_WRITE_US * 8)
+
+struct Expected {
+    int preset_index;
+    int channel;
+    int calibration_position_1;
+    int calibration_position_2;
+    bool start_in_calibration_mode;
+    int saved_positions[NUM_SAVED_POSITIONS];
+    unsigned int max_speed[MAX_PROFILES];
+    int max_accel[MAX_PROFILES];
+};
+
+static uint32_t rng_state;
+static Expected expected;
+// before the last change, which a power cut may take back
+static Expected before;
+static unsigned long key_writes[SETTINGS_LOG_KEYS];
+static unsigned long failures;
+static unsigned long cuts_with_queue;
+static unsigned long changes_lost;
+
+// how long changes held up their caller, in us
+struct Latency {
+    unsigned long count;
+    unsigned long worst;
+    unsigned long long total;
+};
+
+enum { LATENCY_WRITE, LATENCY_PRESET, LATENCY_COMPACT, LATENCY_KINDS };
+static Latency latency[LATENCY_KINDS];
+
+static uint32_t _random(uint32_t bound)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state % bound;
+}
+
+// want, or what it was before the last change when a power cut may have
+// taken it back
+static void _check(const char *what, long got, long want, long was)
+{
+    if (got != want && got != was) {
+        if (failures < 10) {
+            fprintf(stderr, "%s: read back %ld, wrote %ld\n", what, got, want);
+        }
+        ++failures;
+    }
+}
+
+static void _check_preset(const Expected &was)
+{
+    int preset = settings_get_preset_index();
+    _check("preset index", preset, expected.preset_index, was.preset_index);
+    _check("max speed", settings_get_max_speed(), expected.max_speed[preset],
+           was.max_speed[preset]);
+    _check("max accel", settings_get_max_accel(), expected.max_accel[preset],
+           was.max_accel[preset]);
+}
+
+static void _check_all(const Expected &was)
+{
+    _check("channel", settings_get_channel(), expected.channel, was.channel);
+    _check("calibration 1", settings_get_calibration_position_1(),
+           expected.calibration_position_1, was.calibration_position_1);
+    _check("calibration 2", settings_get_calibration_position_2(),
+           expected.calibration_position_2, was.calibration_position_2);
+    _check("start in calibration", settings_get_start_in_calibration_mode(),
+           expected.start_in_calibration_mode, was.start_in_calibration_mode);
+    for (int i = 0; i < NUM_SAVED_POSITIONS; ++i) {
+        _check("saved position", settings_get_saved_position(i),
+               expected.saved_positions[i], was.saved_positions[i]);
+    }
+    _check_preset(was);
+}
+
+// what the unit holds now, once it has been checked against expected
+static void _read_back(Expected *e)
+{
+    e->preset_index = settings_get_preset_index();
+    e->channel = settings_get_channel();
+    e->calibration_position_1 = settings_get_calibration_position_1();
+    e->calibration_position_2 = settings_get_calibration_position_2();
+    e->start_in_calibration_mode = settings_get_start_in_calibration_mode();
+    for (int i = 0; i < NUM_SAVED_POSITIONS; ++i) {
+        e->saved_positions[i] = settings_get_saved_position(i);
+    }
+    e->max_speed[e->preset_index] = settings_get_max_speed();
+    e->max_accel[e->preset_index] = settings_get_max_accel();
+}
+
+static bool _same(const Expected &a, const Expected &b)
+{
+    bool same = a.preset_index == b.preset_index &&
+        a.channel == b.channel &&
+        a.calibration_position_1 == b.calibration_position_1 &&
+        a.calibration_position_2 == b.calibration_position_2 &&
+        a.start_in_calibration_mode == b.start_in_calibration_mode;
+    for (int i = 0; i < NUM_SAVED_POSITIONS; ++i) {
+        same = same && a.saved_positions[i] == b.saved_positions[i];
+    }
+    for (int i = 0; i < MAX_PROFILES; ++i) {
+        same = same && a.max_speed[i] == b.max_speed[i] &&
+            a.max_accel[i] == b.max_accel[i];
+    }
+    return same;
+}
+
+static void _power_cycle()
+{
+    // the supply goes without warning, and the queue with it
+    host_advance_micros(_random(POWER_CUT_MAX_US));
+    bool queued = eeprom_pending() > 0;
+    eeprom_init();
+    settings_init();
+    _check_all(before);
+
+    if (queued) {
+        ++cuts_with_queue;
+        Expected now = expected;
+        _read_back(&now);
+        if (!_same(now, expected)) {
+            ++changes_lost;
+        }
+        expected = now;
+    }
+}
+
+static void _change_speed_or_accel()
+{
+    int preset = expected.preset_index;
+    if (_random(2)) {
+        unsigned int speed = 1 + _random(32768);
+        settings_set_max_speed(speed);
+        expected.max_speed[preset] = speed;
+        ++key_writes[SETTINGS_LOG_MAX_SPEED + preset];
+    } else {
+        int accel = 4 + _random(1000);
+        settings_set_max_accel(accel);
+        expected.max_accel[preset] = accel;
+        ++key_writes[SETTINGS_LOG_MAX_ACCEL + preset];
+    }
+    // what FLUSH_SETTINGS_TIMEOUT_SIG does 4 s later
+    settings_flush_debounced_values();
+}
+
+static void _switch_preset()
+{
+    int preset = _random(NUM_SAVED_POSITIONS);
+    settings_set_preset_index(preset);
+    expected.preset_index = preset;
+    ++key_writes[SETTINGS_LOG_PRESET_INDEX];
+    _check_preset(expected);
+}
+
+static void _save_position()
+{
+    int index = _random(NUM_SAVED_POSITIONS);
+    int position = (int)_random(20000) - 10000;
+    settings_set_saved_position(index, position);
+    expected.saved_positions[index] = position;
+    ++key_writes[SETTINGS_LOG_SAVED_POSITION + index];
+}
+
+static void _calibrate()
+{
+    expected.calibration_position_1 = (int)_random(1000);
+    expected.calibration_position_2 = 1000 + (int)_random(10000);
+    settings_set_calibration_position_1(expected.calibration_position_1);
+    settings_set_calibration_position_2(expected.calibration_position_2);
+    ++key_writes[SETTINGS_LOG_CAL_POS_1];
+    ++key_writes[SETTINGS_LOG_CAL_POS_2];
+}
+
+static const char *_owner(int addr)
+{
+    if (addr >= SETTINGS_LOG_START && addr < SETTINGS_LOG_END) {
+        return "settings log";
+    } else if (addr >= PROFILE_SETTINGS_START) {
+        return "profiles";
+    } else if (addr >= PRESET_INDEX_OFFSET) {
+        return "globals";
+    }
+    return "sentinel";
+}
+
+static const char *_key_name(int key)
+{
+    static char buffer[24];
+    if (key >= SETTINGS_LOG_MAX_ACCEL) {
+        sprintf(buffer, "max accel %d", key - SETTINGS_LOG_MAX_ACCEL);
+    } else if (key >= SETTINGS_LOG_MAX_SPEED) {
+        sprintf(buffer, "max speed %d", key - SETTINGS_LOG_MAX_SPEED);
+    } else if (key >= SETTINGS_LOG_SAVED_POSITION) {
+        sprintf(buffer, "saved position %d", key - SETTINGS_LOG_SAVED_POSITION);
+    } else {
+        static const char *names[] = {
+            "checkpoint", "preset index", "channel", "calibration 1",
+            "calibration 2", "start in calibration",
+        };
+        return names[key];
+    }
+    return buffer;
+}
+
+static void _report(int days)
+{
+    unsigned long total = 0;
+    unsigned long log_total = 0;
+    std::vector<std::pair<unsigned long, int> > cells;
+    for (int addr = 0; addr < HOST_EEPROM_SIZE; ++addr) {
+        unsigned long writes = EEPROM.writes[addr];
+        total += writes;
+        if (addr >= SETTINGS_LOG_START && addr < SETTINGS_LOG_END) {
+            log_total += writes;
+        }
+        if (writes) {
+            cells.push_back(std::make_pair(writes, addr));
+        }
+    }
+    std::sort(cells.rbegin(), cells.rend());
+
+    unsigned long changes = 0;
+    int hottest_key = 0;
+    for (int key = 0; key < SETTINGS_LOG_KEYS; ++key) {
+        changes += key_writes[key];
+        if (key_writes[key] > key_writes[hottest_key]) {
+            hottest_key = key;
+        }
+    }
+
+    printf("%d days of %d hours, %lu settings changes, %lu bytes written, "
+           "%lu skipped as unchanged\n",
+           days, HOURS_PER_DAY, changes, total, eeprom_stats.skipped);
+    printf("%lu power cuts with writes queued, %lu changes lost to them\n\n",
+           cuts_with_queue, changes_lost);
+
+    static const char *kinds[] = {
+        "writes only", "preset switch", "compacting",
+    };
+    printf("caller held up (us)   %9s %9s %9s\n", "changes", "mean", "max");
+    for (int i = 0; i < LATENCY_KINDS; ++i) {
+        printf("  %-19s %9lu %9.0f %9lu\n", kinds[i], latency[i].count,
+               latency[i].count ? (double)latency[i].total / latency[i].count : 0,
+               latency[i].worst);
+    }
+    printf("\n");
+
+    printf("hottest cells\n");
+    for (size_t i = 0; i < cells.size() && i < 8; ++i) {
+        printf("  %4d %-14s %8lu writes\n",
+               cells[i].second, _owner(cells[i].second), cells[i].first);
+    }
+
+    printf("\nwrites per 64 byte page (max cell / total)\n");
+    for (int page = 0; page < HOST_EEPROM_SIZE / 64; ++page) {
+        unsigned long hottest = 0;
+        unsigned long sum = 0;
+        for (int addr = page * 64; addr < (page + 1) * 64; ++addr) {
+            if (EEPROM.writes[addr] > hottest) {
+                hottest = EEPROM.writes[addr];
+            }
+            sum += EEPROM.writes[addr];
+        }
+        if (sum) {
+            printf("  %4d-%4d %-14s %8lu %10lu\n", page * 64, page * 64 + 63,
+                   _owner(page * 64 + 63), hottest, sum);
+        }
+    }
+
+    int log_cells = SETTINGS_LOG_RECORDS * SETTINGS_LOG_RECORD_SIZE;
+    double worst = cells.empty() ? 0 : (double)cells[0].first / days;
+    double in_place = (double)key_writes[hottest_key] / days;
+    printf("\nsettings log: %.0f writes per cell on average over %d cells\n",
+           (double)log_total / log_cells, log_cells);
+    printf("worst cell:   %.1f writes/day, %.1f years to %d cycles\n",
+           worst, worst ? CELL_ENDURANCE / worst / 365 : 0.0,
+           CELL_ENDURANCE);
+    printf("in place:     %.1f writes/day (%s), %.1f years to %d cycles\n",
+           in_place, _key_name(hottest_key),
+           in_place ? CELL_ENDURANCE / in_place / 365 : 0.0, CELL_ENDURANCE);
+}
+
+int main(int argc, char **argv)
+{
+    int days = argc > 1 ? atoi(argv[1]) : 365;
+    rng_state = argc > 2 ? strtoul(argv[2], 0, 0) : 0x1234567;
+    if (!rng_state) {
+        rng_state = 1;
+    }
+
+    // a fresh part; the first boot writes the defaults
+    host_use_virtual_time(true);
+    EEPROM.erase();
+    eeprom_init();
+    settings_init();
+    expected.channel = DEFAULT_CHANNEL;
+    expected.calibration_position_1 = DEFAULT_CAL_POS_1;
+    expected.calibration_position_2 = DEFAULT_CAL_POS_2;
+    for (int i = 0; i < MAX_PROFILES; ++i) {
+        expected.max_speed[i] = DEFAULT_MAX_SPEED;
+        expected.max_accel[i] = DEFAULT_MAX_ACCEL * 4;
+    }
+    _check_all(expected);
+    eeprom_flush();
+    // only count what use costs
+    memset(EEPROM.writes, 0, sizeof(EEPROM.writes));
+    eeprom_reset_stats();
+
+    const int events_per_hour =
+        SPEED_ACCEL_FLUSHES + PRESET_SWITCHES + SAVED_POSITIONS;
+    const int events_per_cycle =
+        events_per_hour * HOURS_PER_DAY / POWER_CYCLES_PER_DAY;
+
+    for (int day = 0; day < days; ++day) {
+        before = expected;
+        _calibrate();
+        for (int cycle = 0; cycle < POWER_CYCLES_PER_DAY; ++cycle) {
+            for (int i = 0; i < events_per_cycle; ++i) {
+                host_advance_micros(EVENT_GAP_US);
+                before = expected;
+
+                int kind = LATENCY_WRITE;
+                int pending = settings_log_pending();
+                unsigned long start_us = micros();
+                int event = _random(events_per_hour);
+                if (event < SPEED_ACCEL_FLUSHES) {
+                    _change_speed_or_accel();
+                } else if (event < SPEED_ACCEL_FLUSHES + PRESET_SWITCHES) {
+                    _switch_preset();
+                    kind = LATENCY_PRESET;
+                } else {
+                    _save_position();
+                }
+                unsigned long us = micros() - start_us;
+                if (settings_log_pending() <= pending) {
+                    kind = LATENCY_COMPACT;
+                }
+
+                Latency *l = &latency[kind];
+                ++l->count;
+                l->total += us;
+                l->worst = (std::max)(l->worst, us);
+            }
+            _power_cycle();
+        }
+    }
+
+    eeprom_flush();
+    _report(days);
+
+    if (failures) {
+        fprintf(stderr, "%lu settings read back wrong\n", failures);
+        return 1;
+    }
+    if (latency[LATENCY_WRITE].worst) {
+        fprintf(stderr, "writing a change waited %lu us on the EEPROM\n",
+                latency[LATENCY_WRITE].worst);
+        return 1;
+    }
+    if (latency[LATENCY_PRESET].worst > HOST_EEPROM_WRITE_US) {
+        fprintf(stderr, "a preset switch waited %lu us on the EEPROM\n",
+                latency[LATENCY_PRESET].worst);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+//****************************************************************************
+// This program is open source software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as published
+// by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+//****************************************************************************
+
+// Lays out the receiver's EEPROM as each earlier firmware left it, from
+// before versioning on, and checks that settings_init() carries the channel
+// (and the motion settings, once there were any) through every migration
+// instead of falling back to defaults.
+//
+//     settings_upgrade
+
+#include <stdio.h>
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "settings.h"
+
+#define OLD_CHANNEL     7
+#define OLD_MAX_SPEED   300
+#define OLD_ACCEL       50
+#define OLD_MODE        1
+
+// where each version's checksummed range ended
+static const int layout_ends[SETTINGS_VERSION] = {
+    0,                  // no checksum
+    CHANNEL_LOC + 2,
+    MODE_LOC + 2,
+};
+
+static void _write_image(int version)
+{
+    for (int i = 0; i < EEPROM.length(); ++i) {
+        EEPROM.write(i, 0xff);
+    }
+    eeprom_write_uint16(SENTINEL_LOC, SENTINEL_VALUE);
+    eeprom_write_int16(CHANNEL_LOC, OLD_CHANNEL);
+    if (version >= 2) {
+        eeprom_write_uint16(MAX_SPEED_LOC, OLD_MAX_SPEED);
+        eeprom_write_int16(ACCEL_LOC, OLD_ACCEL);
+        eeprom_write_int16(MODE_LOC, OLD_MODE);
+    }
+    if (version >= 1) {
+        eeprom_write_char(SETTINGS_VERSION_LOC, version);
+        eeprom_write_uint16(SETTINGS_CRC_LOC,
+            eeprom_crc16(SETTINGS_START, layout_ends[version] - SETTINGS_START,
+                         EEPROM_CRC16_INIT));
+    }
+}
+
+static int _check(int version, const char *what, long got, long want)
+{
+    if (got == want) {
+        return 0;
+    }
+    fprintf(stderr, "version %d: %s is %ld, not %ld\n", version, what, got,
+            want);
+    return 1;
+}
+
+int main()
+{
+    int failures = 0;
+    for (int version = 0; version < SETTINGS_VERSION; ++version) {
+        _write_image(version);
+        settings_init();
+
+        failures += _check(version, "version",
+            eeprom_read_char(SETTINGS_VERSION_LOC), SETTINGS_VERSION);
+        failures += _check(version, "channel",
+            settings_get_channel(), OLD_CHANNEL);
+        failures += _check(version, "axis", settings_get_axis(), DEFAULT_AXIS);
+        bool moved = version >= 2;
+        failures += _check(version, "max speed", settings_get_max_speed(),
+            moved ? OLD_MAX_SPEED : DEFAULT_MAX_SPEED);
+        failures += _check(version, "accel", settings_get_accel(),
+            moved ? OLD_ACCEL : DEFAULT_ACCEL);
+        failures += _check(version, "mode", settings_get_mode(),
+            moved ? OLD_MODE : DEFAULT_MODE);
+    }
+
+    printf("%d layouts upgraded, %d failures\n", SETTINGS_VERSION, failures);
+    return failures ? 1 : 0;
+}
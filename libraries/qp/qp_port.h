@@ -45,6 +45,9 @@
 //#define QK_PREEMPTIVE           1
                                   // allow using the QK priority ceiling mutex
 //#define QK_MUTEX                1
+                 // the macro Q_SPY selects the QS software tracing build, see
+                 // QS::onStartup() in Txr/bsp.cpp and host/qspy
+//#define Q_SPY                   1
 
                         // various QF object sizes configuration for this port
 #define QF_MAX_ACTIVE           8